@@ -0,0 +1,529 @@
+#include "../xml11/xml11.hpp"
+#include "corpus.hpp"
+
+#include "benchmark/benchmark.h"
+
+#include <string>
+
+using namespace xml11;
+using namespace std::string_literals;
+
+/********************************************************************************
+ * Documents.
+ ********************************************************************************/
+
+static Node MakeEmployer(const size_t i)
+{
+    return Node {"Employer", {
+            {"id", std::to_string(i), NodeType::ATTRIBUTE},
+            {"Name", "Artem"},
+            {"Surname", "Pushkin"},
+            {"Position", "Developer"},
+            {"Salary", std::to_string(1000 + i)},
+            {"Address", {
+                {"City", "Moscow"},
+                {"Street", "Lenina"},
+            }},
+        }};
+}
+
+static Node MakeDocument(const size_t employers)
+{
+    Node root {"Employers"};
+    for (size_t i = 0; i < employers; ++i) {
+        root.addNode(MakeEmployer(i));
+    }
+    return root;
+}
+
+static Node MakeWideDocument(const size_t width)
+{
+    Node root {"Items"};
+    for (size_t i = 0; i < width; ++i) {
+        root.addNode(Node {"Item" + std::to_string(i), std::to_string(i)});
+    }
+    return root;
+}
+
+static Node MakeDeepDocument(const size_t depth)
+{
+    Node root {"Level", "0"};
+    for (size_t i = 1; i < depth; ++i) {
+        root = Node {"Level", {root}};
+    }
+    return root;
+}
+
+// A telemetry-like document whose leaves are numbers.
+static Node MakeNumbersDocument(const int rows)
+{
+    Node root {"Root"};
+    for (int i = 0; i < rows; ++i) {
+        root.addNode(Node {"Row",
+            Node {"Id", i},
+            Node {"Amount", i * 1000003LL},
+            Node {"Ratio", i / 7.0},
+            Node {"Code", std::optional<unsigned> {static_cast<unsigned>(i)}, NodeType::OPTIONAL},
+        });
+    }
+    return root;
+}
+
+static std::string MakeDeepPath(const size_t depth)
+{
+    std::string path;
+    for (size_t i = 1; i < depth; ++i) {
+        path += i > 1 ? "/Level" : "Level";
+    }
+    return path;
+}
+
+/********************************************************************************
+ * Per-iteration costs of the measured operation, from xml11::stats().
+ ********************************************************************************/
+
+static void ReportStats(benchmark::State& state, const Operation operation)
+{
+    const auto& counters = stats()[operation];
+    const auto iterations = static_cast<double>(state.iterations());
+
+    state.counters["allocs"] = counters.allocations / iterations;
+    state.counters["bytes"] = counters.bytes / iterations;
+    state.counters["nodes"] = counters.nodes / iterations;
+    state.counters["refs"] = counters.refcounts / iterations;
+}
+
+/********************************************************************************
+ * Parsing.
+ ********************************************************************************/
+
+static void BM_FromString(benchmark::State& state, corpus::Options options)
+{
+    options.nodes = state.range(0);
+    const auto text = corpus::Generator {options}.text();
+
+    stats().reset();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Node::fromString(text));
+    }
+
+    ReportStats(state, Operation::PARSE);
+
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK_CAPTURE(BM_FromString, mixed, corpus::Options {})
+    ->Arg(10)->Arg(1000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_FromString, deep, corpus::Deep())
+    ->Arg(10000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_FromString, wide, corpus::Wide())
+    ->Arg(10000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_FromString, attributes, corpus::AttributeHeavy())
+    ->Arg(10000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_FromString, blobs, corpus::Blobs())
+    ->Arg(10000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_FromString, mixed_case, corpus::MixedCase())
+    ->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+// The same values trimmed by a std::function and by an in-place filter.
+static void BM_FromStringFiltered(benchmark::State& state)
+{
+    corpus::Options options;
+    options.nodes = 10000;
+    const auto text = corpus::Generator {options}.text();
+
+    const ValueFilter trim = [](const std::string& value) {
+        auto result = value;
+        Trim {}(result);
+        return result;
+    };
+
+    stats().reset();
+    for (auto _ : state) {
+        if (state.range(0)) {
+            benchmark::DoNotOptimize(Node::fromString(text, true, Trim {}));
+        }
+        else {
+            benchmark::DoNotOptimize(Node::fromString(text, true, trim));
+        }
+    }
+
+    ReportStats(state, Operation::PARSE);
+
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_FromStringFiltered)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+// A Cyrillic document read as UTF-8 and as windows-1251 converted first.
+static void BM_FromStringEncoded(benchmark::State& state)
+{
+    std::string text = "<?xml version=\"1.0\" encoding=\"UTF-8\"?><Root>";
+    for (int i = 0; i < 10000; ++i) {
+        text += "<Item Name=\"Привет\">Привет, мир " + std::to_string(i) + "</Item>";
+    }
+    text += "</Root>";
+    if (state.range(0)) {
+        text = FromUtf8(text, Encoding::WINDOWS_1251);
+    }
+
+    stats().reset();
+    for (auto _ : state) {
+        if (state.range(0)) {
+            benchmark::DoNotOptimize(Node::fromString(text, Encoding::WINDOWS_1251));
+        }
+        else {
+            benchmark::DoNotOptimize(Node::fromString(text));
+        }
+    }
+
+    ReportStats(state, Operation::PARSE);
+
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_FromStringEncoded)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+// A document of about a megabyte, parsed over and over by the same thread.
+static void BM_FromStringMegabyte(benchmark::State& state)
+{
+    corpus::Options options;
+    options.nodes = 25000;
+    const auto text = corpus::Generator {options}.text();
+
+    stats().reset();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Node::fromString(text));
+    }
+
+    ReportStats(state, Operation::PARSE);
+
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_FromStringMegabyte)->Unit(benchmark::kMillisecond);
+
+// Every level holds a leaf and the next level, so the cost of finding the
+// parent of a node shows up as a quadratic growth of the time.
+static void BM_FromStringDeepNesting(benchmark::State& state)
+{
+    const auto depth = static_cast<size_t>(state.range(0));
+
+    std::string text;
+    for (size_t i = 0; i < depth; ++i) {
+        text += "<Level><Id>" + std::to_string(i) + "</Id>";
+    }
+    for (size_t i = 0; i < depth; ++i) {
+        text += "</Level>";
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Node::fromString(text));
+    }
+
+    state.SetComplexityN(state.range(0));
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_FromStringDeepNesting)
+    ->Arg(1000)->Arg(4000)->Arg(16000)->Complexity(benchmark::oN)->Unit(benchmark::kMicrosecond);
+
+// A handler that reads one record of a large export: the whole tree is
+// built (0) or only the record that is read (1).
+static void BM_FromStringLazily(benchmark::State& state)
+{
+    corpus::Options options;
+    options.nodes = 25000;
+    const auto text = corpus::Generator {options}.text();
+    const auto isLazy = state.range(0) != 0;
+
+    for (auto _ : state) {
+        const auto root = isLazy ? Node::fromStringLazily(text) : Node::fromString(text);
+        const auto children = root.nodes();
+        benchmark::DoNotOptimize(children[children.size() / 2].nodes());
+    }
+
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_FromStringLazily)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// Parses a document and reads a few values of every record: into a tree of
+// nodes (0) or into a read-only tape (1).
+static void BM_QueryTape(benchmark::State& state)
+{
+    const auto text = MakeDocument(10000).toString(false);
+    const auto isTape = state.range(0) != 0;
+
+    stats().reset();
+    for (auto _ : state) {
+        size_t total = 0;
+        if (isTape) {
+            const auto document = TapeDocument::fromString(text);
+            for (const auto& employer : document.root().findNodes("Employer")) {
+                total += employer("id").text().size() + employer.findNodeXPath("Address/City").text().size();
+            }
+        }
+        else {
+            const auto root = Node::fromString(text);
+            for (const auto& employer : root.findNodes("Employer")) {
+                total += employer("id").text().size() + employer.findNodeXPath("Address/City").text().size();
+            }
+        }
+        benchmark::DoNotOptimize(total);
+    }
+
+    ReportStats(state, Operation::PARSE);
+
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_QueryTape)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+static void BM_FromStringInParallel(benchmark::State& state)
+{
+    corpus::Options options;
+    options.nodes = 100000;
+    const auto text = corpus::Generator {options}.text();
+    const auto threads = static_cast<size_t>(state.range(0));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Node::fromStringInParallel(text, true, nullptr, threads));
+    }
+
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_FromStringInParallel)->RangeMultiplier(2)->Range(1, 16)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_ParseBatch(benchmark::State& state)
+{
+    corpus::Options options;
+    options.nodes = 100;
+
+    std::vector<std::string> texts;
+    size_t bytes = 0;
+    for (size_t i = 0; i < 1000; ++i) {
+        options.seed = i + 1;
+        texts.emplace_back(corpus::Generator {options}.text());
+        bytes += texts.back().size();
+    }
+    const auto threads = static_cast<size_t>(state.range(0));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parseBatch(texts, true, nullptr, threads));
+    }
+
+    state.SetBytesProcessed(state.iterations() * bytes);
+}
+BENCHMARK(BM_ParseBatch)->RangeMultiplier(2)->Range(1, 16)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+/********************************************************************************
+ * Lookups. The second argument selects case-insensitive matching, and then
+ * the name is looked up in a different case than it was written in.
+ ********************************************************************************/
+
+static void BM_FindNodeWide(benchmark::State& state)
+{
+    const auto width = static_cast<size_t>(state.range(0));
+    const bool isCaseInsensitive = state.range(1);
+
+    auto root = MakeWideDocument(width);
+    root.isCaseInsensitive(isCaseInsensitive);
+    const auto name = (isCaseInsensitive ? "ITEM"s : "Item"s) + std::to_string(width - 1);
+
+    stats().reset();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(root.findNode(name));
+    }
+
+    ReportStats(state, Operation::FIND);
+}
+BENCHMARK(BM_FindNodeWide)->Args({16, 0})->Args({16, 1})->Args({1024, 0})->Args({1024, 1});
+
+static void BM_FindNodesWide(benchmark::State& state)
+{
+    const bool isCaseInsensitive = state.range(1);
+
+    auto root = MakeDocument(state.range(0));
+    root.isCaseInsensitive(isCaseInsensitive);
+    const auto name = isCaseInsensitive ? "employer"s : "Employer"s;
+
+    stats().reset();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(root.findNodes(name));
+    }
+
+    ReportStats(state, Operation::FIND);
+}
+BENCHMARK(BM_FindNodesWide)->Args({16, 0})->Args({16, 1})->Args({1024, 0})->Args({1024, 1});
+
+static void BM_FindNodeXPathDeep(benchmark::State& state)
+{
+    const auto depth = static_cast<size_t>(state.range(0));
+    const bool isCaseInsensitive = state.range(1);
+
+    auto root = MakeDeepDocument(depth);
+    root.isCaseInsensitive(isCaseInsensitive);
+    auto path = MakeDeepPath(depth);
+    if (isCaseInsensitive) {
+        path = to_lower_copy(path);
+    }
+
+    stats().reset();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(root.findNodeXPath(path));
+    }
+
+    ReportStats(state, Operation::FIND);
+}
+BENCHMARK(BM_FindNodeXPathDeep)->Args({16, 0})->Args({16, 1})->Args({256, 0})->Args({256, 1});
+
+// Sums the values of a numeric document, with the standard conversions of
+// a copy of each text and with as<T> over the text itself.
+static void BM_ReadNumbers(benchmark::State& state)
+{
+    std::string text = "<Root>";
+    for (int i = 0; i < 10000; ++i) {
+        text += "<Row Id=\"" + std::to_string(i) + "\"><Price>" + std::to_string(i * 0.37) + "</Price></Row>";
+    }
+    text += "</Root>";
+    const auto root = Node::fromString(text);
+    const auto rows = root["Row"];
+
+    stats().reset();
+    for (auto _ : state) {
+        double sum = 0;
+        for (const auto& row : rows) {
+            if (state.range(0)) {
+                sum += row("Id").as<int>() + row("Price").as<double>();
+            }
+            else {
+                sum += std::stoi(row("Id").text()) + std::stod(row("Price").text());
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    ReportStats(state, Operation::FIND);
+}
+BENCHMARK(BM_ReadNumbers)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+/********************************************************************************
+ * Building.
+ ********************************************************************************/
+
+static void BM_BuildDeclarative(benchmark::State& state)
+{
+    size_t i = 0;
+    stats().reset();
+    for (auto _ : state) {
+        // Charge the argument lists of the nested nodes to the build as well.
+        const StatsScope scope {Operation::BUILD};
+        benchmark::DoNotOptimize(MakeEmployer(i++));
+    }
+
+    ReportStats(state, Operation::BUILD);
+}
+BENCHMARK(BM_BuildDeclarative);
+
+static void BM_BuildNumbers(benchmark::State& state)
+{
+    stats().reset();
+    for (auto _ : state) {
+        const StatsScope scope {Operation::BUILD};
+        benchmark::DoNotOptimize(MakeNumbersDocument(1000));
+    }
+
+    ReportStats(state, Operation::BUILD);
+}
+BENCHMARK(BM_BuildNumbers)->Unit(benchmark::kMicrosecond);
+
+/********************************************************************************
+ * Serialization.
+ ********************************************************************************/
+
+static void BM_ToString(benchmark::State& state)
+{
+    corpus::Options options;
+    options.nodes = state.range(0);
+    const auto root = corpus::Generator {options}.node();
+    const bool indent = state.range(1);
+
+    size_t bytes = 0;
+    stats().reset();
+    for (auto _ : state) {
+        const auto text = root.toString(indent);
+        bytes += text.size();
+        benchmark::DoNotOptimize(text.data());
+    }
+
+    ReportStats(state, Operation::SERIALIZE);
+
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_ToString)->Args({1000, 0})->Args({1000, 1})->Args({100000, 0})->Args({100000, 1})->Unit(benchmark::kMicrosecond);
+
+static void BM_ToStringNumbers(benchmark::State& state)
+{
+    const auto root = MakeNumbersDocument(1000);
+
+    stats().reset();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(root.toString(false));
+    }
+
+    ReportStats(state, Operation::SERIALIZE);
+}
+BENCHMARK(BM_ToStringNumbers)->Unit(benchmark::kMicrosecond);
+
+static void BM_ToSlices(benchmark::State& state, corpus::Options options)
+{
+    options.nodes = state.range(0);
+    const auto root = corpus::Generator {options}.node();
+    const bool indent = state.range(1);
+
+    size_t bytes = 0;
+    stats().reset();
+    for (auto _ : state) {
+        const auto slices = root.toSlices(indent);
+        bytes += slices.size();
+        benchmark::DoNotOptimize(slices.slices().data());
+    }
+
+    ReportStats(state, Operation::SERIALIZE);
+
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK_CAPTURE(BM_ToSlices, mixed, corpus::Options {})
+    ->Args({1000, 0})->Args({1000, 1})->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_ToSlices, blobs, corpus::Blobs())
+    ->Args({1000, 0})->Args({1000, 1})->Unit(benchmark::kMicrosecond);
+
+static void BM_ToStringInParallel(benchmark::State& state)
+{
+    corpus::Options options;
+    options.nodes = 100000;
+    const auto root = corpus::Generator {options}.node();
+    const auto threads = static_cast<size_t>(state.range(0));
+
+    size_t bytes = 0;
+    for (auto _ : state) {
+        const auto text = root.toStringInParallel(true, nullptr, threads);
+        bytes += text.size();
+        benchmark::DoNotOptimize(text.data());
+    }
+
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_ToStringInParallel)->RangeMultiplier(2)->Range(1, 16)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_SerializeBatch(benchmark::State& state)
+{
+    corpus::Options options;
+    options.nodes = 100;
+
+    NodeList roots;
+    for (size_t i = 0; i < 1000; ++i) {
+        options.seed = i + 1;
+        roots.emplace_back(corpus::Generator {options}.node());
+    }
+    const auto threads = static_cast<size_t>(state.range(0));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(serializeBatch(roots, false, nullptr, threads));
+    }
+}
+BENCHMARK(BM_SerializeBatch)->RangeMultiplier(2)->Range(1, 16)->UseRealTime()->Unit(benchmark::kMillisecond);
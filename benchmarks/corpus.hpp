@@ -0,0 +1,356 @@
+#pragma once
+
+#include "../xml11/xml11.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace corpus {
+
+/********************************************************************************
+ * Deterministic synthetic documents for benchmarks.
+ *
+ * The same options always give the same document, on every platform: the
+ * generator uses its own random engine instead of <random> distributions,
+ * whose output differs between standard libraries. A document can be produced
+ * either as XML text or as a Node tree and both describe the same structure.
+ ********************************************************************************/
+
+struct Options final {
+    uint64_t seed {1};
+    size_t nodes {1000};        // elements in the document, root included
+    size_t depth {6};           // levels below the root
+    size_t fanOut {8};          // children of an inner element, at most
+    size_t attributes {2};      // attributes of an element, at most
+    size_t textSize {16};       // length of a leaf text, at most
+    size_t blobSize {0};        // every eighth leaf carries a blob this long
+    bool cdata {false};         // blobs are written as CDATA sections
+    bool mixedCase {false};     // names are spelled in varying case
+};
+
+/********************************************************************************
+ * Typical shapes.
+ ********************************************************************************/
+
+inline Options Deep() noexcept
+{
+    Options options;
+    options.depth = 64;
+    options.fanOut = 2;
+    return options;
+}
+
+inline Options Wide() noexcept
+{
+    Options options;
+    options.depth = 1;
+    return options;
+}
+
+inline Options AttributeHeavy() noexcept
+{
+    Options options;
+    options.attributes = 12;
+    return options;
+}
+
+inline Options Blobs() noexcept
+{
+    Options options;
+    options.blobSize = 4096;
+    options.cdata = true;
+    return options;
+}
+
+inline Options MixedCase() noexcept
+{
+    Options options;
+    options.mixedCase = true;
+    return options;
+}
+
+class Generator final {
+public:
+    inline explicit Generator(const Options& options) noexcept
+        : m_options {options}
+    {
+
+    }
+
+    /********************************************************************************
+     * Main functions.
+     ********************************************************************************/
+
+    inline std::string text() const
+    {
+        TextSink sink;
+        generate(sink);
+        return std::move(sink.result);
+    }
+
+    inline xml11::Node node() const
+    {
+        NodeSink sink;
+        generate(sink);
+        return std::move(sink.result);
+    }
+
+private:
+
+    /********************************************************************************
+     * Random engine (splitmix64).
+     ********************************************************************************/
+
+    class Random final {
+    public:
+        inline explicit Random(const uint64_t seed) noexcept
+            : m_state {seed}
+        {
+
+        }
+
+        inline uint64_t next() noexcept
+        {
+            uint64_t z = (m_state += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            return z ^ (z >> 31);
+        }
+
+        inline size_t below(const size_t bound) noexcept
+        {
+            return bound ? static_cast<size_t>(next() % bound) : 0;
+        }
+
+    private:
+        uint64_t m_state {0};
+    };
+
+    /********************************************************************************
+     * Sinks.
+     ********************************************************************************/
+
+    struct TextSink final {
+        std::string result {"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"};
+        bool isTagOpen {false};
+
+        inline void open(const std::string& name)
+        {
+            closeTag();
+            result += '<';
+            result += name;
+            isTagOpen = true;
+        }
+
+        inline void attribute(const std::string& name, const std::string& value)
+        {
+            result += ' ';
+            result += name;
+            result += "=\"";
+            escape(value);
+            result += '"';
+        }
+
+        inline void text(const std::string& value, const bool cdata)
+        {
+            closeTag();
+            if (cdata) {
+                result += "<![CDATA[";
+                result += value;
+                result += "]]>";
+            }
+            else {
+                escape(value);
+            }
+        }
+
+        inline void close(const std::string& name)
+        {
+            if (isTagOpen) {
+                result += "/>";
+                isTagOpen = false;
+            }
+            else {
+                result += "</";
+                result += name;
+                result += '>';
+            }
+        }
+
+        inline void closeTag()
+        {
+            if (isTagOpen) {
+                result += '>';
+                isTagOpen = false;
+            }
+        }
+
+        inline void escape(const std::string& value)
+        {
+            for (const auto c : value) {
+                switch (c) {
+                case '&': result += "&amp;"; break;
+                case '<': result += "&lt;"; break;
+                case '>': result += "&gt;"; break;
+                case '"': result += "&quot;"; break;
+                default: result += c; break;
+                }
+            }
+        }
+    };
+
+    struct NodeSink final {
+        xml11::Node result {};
+        std::vector<xml11::Node> stack {};
+
+        inline void open(const std::string& name)
+        {
+            stack.emplace_back(name);
+        }
+
+        inline void attribute(const std::string& name, const std::string& value)
+        {
+            stack.back().addNode(xml11::Node {name, value, xml11::NodeType::ATTRIBUTE});
+        }
+
+        inline void text(const std::string& value, const bool cdata)
+        {
+            stack.back().text(value);
+            if (cdata) {
+                stack.back().type(xml11::NodeType::CDATA);
+            }
+        }
+
+        inline void close(const std::string&)
+        {
+            auto node = std::move(stack.back());
+            stack.pop_back();
+
+            if (stack.empty()) {
+                result = std::move(node);
+            }
+            else {
+                stack.back().addNode(std::move(node));
+            }
+        }
+    };
+
+    /********************************************************************************
+     * Generation.
+     ********************************************************************************/
+
+    template <class Sink>
+    inline void generate(Sink& sink) const
+    {
+        Random random {m_options.seed};
+        size_t budget = m_options.nodes ? m_options.nodes - 1 : 0;
+        size_t leaves = 0;
+
+        const auto root = name(random, ElementNames());
+        sink.open(root);
+        attributes(sink, random);
+        while (budget) {
+            element(sink, random, 1, budget, leaves);
+        }
+        sink.close(root);
+    }
+
+    template <class Sink>
+    inline void element(Sink& sink, Random& random, const size_t level, size_t& budget, size_t& leaves) const
+    {
+        --budget;
+
+        const auto tag = name(random, ElementNames());
+        sink.open(tag);
+        attributes(sink, random);
+
+        const bool isLeaf = level >= m_options.depth or random.below(4) == 0;
+        if (isLeaf or not budget) {
+            if (m_options.blobSize and ++leaves % 8 == 0) {
+                sink.text(value(random, m_options.blobSize, m_options.blobSize), m_options.cdata);
+            }
+            else if (m_options.textSize) {
+                sink.text(value(random, 1, m_options.textSize), false);
+            }
+        }
+        else {
+            const auto children = 1 + random.below(m_options.fanOut);
+            for (size_t i = 0; i < children and budget; ++i) {
+                element(sink, random, level + 1, budget, leaves);
+            }
+        }
+
+        sink.close(tag);
+    }
+
+    template <class Sink>
+    inline void attributes(Sink& sink, Random& random) const
+    {
+        const auto& names = AttributeNames();
+        const auto count = std::min(random.below(m_options.attributes + 1), names.size());
+        const auto first = random.below(names.size());
+
+        // Consecutive entries of the vocabulary, so names never repeat on a node.
+        for (size_t i = 0; i < count; ++i) {
+            sink.attribute(spell(random, names[(first + i) % names.size()]), value(random, 1, 12));
+        }
+    }
+
+    inline std::string name(Random& random, const std::vector<std::string>& names) const
+    {
+        return spell(random, names[random.below(names.size())]);
+    }
+
+    inline std::string spell(Random& random, std::string name) const
+    {
+        if (m_options.mixedCase) {
+            switch (random.below(3)) {
+            case 1: name = xml11::to_lower_copy(name); break;
+            case 2: std::transform(name.begin(), name.end(), name.begin(), ::toupper); break;
+            default: break;
+            }
+        }
+        return name;
+    }
+
+    static inline std::string value(Random& random, const size_t minSize, const size_t maxSize)
+    {
+        static const std::string alphabet =
+            "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789    .,-&<\"";
+
+        // Values start with a letter or digit: parsers drop whitespace-only text.
+        std::string result(minSize + random.below(maxSize - minSize + 1), ' ');
+        for (size_t i = 0; i < result.size(); ++i) {
+            result[i] = alphabet[random.below(i ? alphabet.size() : 62)];
+        }
+        return result;
+    }
+
+    static inline const std::vector<std::string>& ElementNames()
+    {
+        static const std::vector<std::string> names {
+            "Employers", "Employer", "Name", "Surname", "Position", "Salary",
+            "Address", "City", "Street", "Building", "Phone", "Email",
+            "Department", "Project", "Task", "Deadline", "Comment", "Author",
+            "Title", "Description", "Status", "Priority", "Tag", "Item",
+        };
+        return names;
+    }
+
+    static inline const std::vector<std::string>& AttributeNames()
+    {
+        static const std::vector<std::string> names {
+            "id", "type", "lang", "ref", "version", "created",
+            "updated", "owner", "visible", "weight", "color", "unit",
+        };
+        return names;
+    }
+
+private:
+    Options m_options {};
+};
+
+} // namespace corpus
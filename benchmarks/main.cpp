@@ -0,0 +1,7 @@
+#include "../xml11/xml11.hpp"
+
+#include "benchmark/benchmark.h"
+
+XML11_DEFINE_ALLOCATION_HOOK()
+
+BENCHMARK_MAIN();
@@ -3,12 +3,17 @@
 #include "gtest/gtest.h"
 
 #include <string>
+#include <thread>
 
 using namespace testing;
 using namespace xml11;
 using namespace xml11::literals;
 using namespace std::string_literals;
 
+// The hook lives next to the code that allocates, so the build checks that
+// it compiles there.
+XML11_DEFINE_ALLOCATION_HOOK()
+
 static std::string GetText() noexcept
 {
     return "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
@@ -725,6 +730,988 @@ TEST(Main, DoNotMistakeANodeWithAString) {
     EXPECT_EQ(want.toString(), got.toString());
 }
 
+#ifdef USE_XML11_NAME_TABLE
+
+TEST(Main, EqualNamesAreInternedOnceAcrossParses) {
+    const auto root1 = GetRoot();
+    const auto root2 = GetRoot();
+    const auto size = NameTable::global().size();
+    const auto root3 = GetRoot();
+
+    EXPECT_EQ(&root1("info").name(), &root2("info").name());
+    EXPECT_EQ(&root1("body")("para").name(), &root2("body")("para").name());
+    EXPECT_EQ(NameTable::global().size(), size);
+    EXPECT_TRUE(root1 == root3);
+}
+
+TEST(Main, LookingUpAnUnknownNameDoesNotGrowTheNameTable) {
+    const auto root = GetEmployers();
+    const auto size = NameTable::global().size();
+
+    EXPECT_FALSE(root("NeverSeenBeforeName"));
+    EXPECT_TRUE(root["NeverSeenBeforeName"].empty());
+    EXPECT_EQ(NameTable::global().size(), size);
+}
+
+#else
+
+TEST(Main, NamesCanBeChangedThroughTheirReference) {
+    auto root = GetRoot();
+    root("info").name() = "Details";
+
+    EXPECT_EQ(root("details")("author").text(), "John Fleck");
+    EXPECT_FALSE(root("info"));
+}
+
+#endif // USE_XML11_NAME_TABLE
+
+TEST(Main, ReadAnAttributeValueWithoutCreatingANode) {
+    const auto info = GetRoot()("info");
+
+    ASSERT_TRUE(info.attr("id1"));
+    EXPECT_EQ(*info.attr("id1"), "123456789");
+    EXPECT_EQ(*info.attr("ID2"), "555");
+    EXPECT_EQ(info.attr("author"), nullptr);
+    EXPECT_EQ(Node{}.attr("id1"), nullptr);
+}
+
+TEST(Main, SettingAnAttributeValueUpdatesOrCreatesIt) {
+    auto info = GetRoot()("info");
+    info.attr("id1", "1").attr("id4", "4");
+
+    EXPECT_EQ(*info.attr("id1"), "1");
+    EXPECT_EQ(*info.attr("id4"), "4");
+    EXPECT_EQ(info[NodeType::ATTRIBUTE].size(), 3);
+    EXPECT_TRUE(info.toString(false).find("id4=\"4\"") != std::string::npos);
+}
+
+TEST(Main, AttributesAreKeptApartFromElementsAndListedFirst) {
+    const Node root {"Employer", {
+            {"name", "Artem"},
+            {"surname", "Pushkin", NodeType::ATTRIBUTE}
+        }};
+
+    EXPECT_EQ(root.nodes().size(), 2);
+    EXPECT_EQ(root.nodes().front().name(), "surname");
+    EXPECT_EQ(root[NodeType::ELEMENT].size(), 1);
+    EXPECT_TRUE(Node::fromString(root.toString()) == root);
+}
+
+TEST(Main, CaseSensitiveDocumentPassesItsModeToChildNodes) {
+    const auto text =
+        "<Employers>"
+        "  <Employer Name=\"Artem\">"
+        "    <Surname>Pushkin</Surname>"
+        "  </Employer>"
+        "</Employers>";
+
+    const auto sensitive = Node::fromString(text, false);
+    const auto employer = sensitive("Employer");
+    EXPECT_TRUE(employer);
+    EXPECT_FALSE(employer.isCaseInsensitive());
+    EXPECT_FALSE(employer("surname"));
+    EXPECT_EQ(employer("Surname").text(), "Pushkin");
+    EXPECT_EQ(employer.attr("name"), nullptr);
+    EXPECT_EQ(*employer.attr("Name"), "Artem");
+
+    const auto insensitive = Node::fromString(text);
+    EXPECT_TRUE(insensitive("employer")("SURNAME").isCaseInsensitive());
+    EXPECT_EQ(insensitive("employer")("SURNAME").text(), "Pushkin");
+    EXPECT_EQ(*insensitive("employer").attr("NAME"), "Artem");
+
+    static_assert(not std::is_constructible<Node, std::shared_ptr<NodeImpl>>::value,
+                  "a handle is always told the mode of its document");
+    EXPECT_FALSE(sensitive.nodes()[0].isCaseInsensitive());
+    EXPECT_FALSE(sensitive[NodeType::ELEMENT][0].isCaseInsensitive());
+    EXPECT_FALSE(sensitive.findNodeXPath("Employer/Surname").isCaseInsensitive());
+}
+
+TEST(Main, EraseManyNodesAtOnceKeepsTheRestInOrder) {
+    Node root {"Employers"};
+    for (size_t i = 0; i < 100; ++i) {
+        root.addNode(Node {"Employer", std::to_string(i)});
+    }
+    root.addNode(Node {"Company", "Google"});
+
+    NodeList odd;
+    for (const auto& node : root["Employer"]) {
+        if (std::stoi(node.text()) % 2) {
+            odd.push_back(node);
+        }
+    }
+
+    root -= odd;
+    ASSERT_EQ(root["Employer"].size(), 50);
+    for (size_t i = 0; i < 50; ++i) {
+        EXPECT_EQ(root["Employer"][i].text(), std::to_string(i * 2));
+    }
+
+    root.eraseNodesIf([](const Node& node) { return node.name() == "Employer"; });
+    ASSERT_EQ(root.nodes().size(), 1);
+    EXPECT_EQ(root.nodes()[0].text(), "Google");
+
+    root.clear();
+    EXPECT_TRUE(root.nodes().empty());
+}
+
+TEST(Main, EraseNodesRemovesASharedChildOnlyAsManyTimesAsListed) {
+    Node root {"Employers"};
+    const Node employer {"Employer", "Artem"};
+    root.addNode(employer);
+    root.addNode(employer);
+
+    root.eraseNodes(NodeList {employer});
+    EXPECT_EQ(root["Employer"].size(), 1);
+}
+
+TEST(Main, ObserverSeesEveryParseAndSerialization) {
+    std::vector<ObserverEvent> events;
+    setObserver([&events](const ObserverEvent& event) {
+        events.push_back(event);
+    });
+
+    const auto text = GetText();
+    const auto result = Node::fromString(text).toString(false);
+
+    setObserver(nullptr);
+    Node::fromString(GetText());
+
+    ASSERT_EQ(events.size(), 2);
+    EXPECT_EQ(events[0].operation, Operation::PARSE);
+    EXPECT_EQ(events[0].bytes, text.size());
+    EXPECT_EQ(events[0].nodes, 18);
+    EXPECT_EQ(events[1].operation, Operation::SERIALIZE);
+    EXPECT_EQ(events[1].bytes, result.size());
+    EXPECT_EQ(events[1].nodes, 18);
+    EXPECT_EQ(events[0].backend, events[1].backend);
+}
+
+TEST(Main, ObserverSeesALazyParseAsOneParseOfTheWholeText) {
+    std::vector<ObserverEvent> events;
+    setObserver([&events](const ObserverEvent& event) {
+        events.push_back(event);
+    });
+
+    const std::string text = "<Root id='1'><A><B></C></A><D>1</D></Root>";
+    const auto root = Node::fromStringLazily(text);
+
+    setObserver(nullptr);
+
+    ASSERT_EQ(events.size(), 1);
+    EXPECT_EQ(events[0].operation, Operation::PARSE);
+    EXPECT_EQ(events[0].bytes, text.size());
+    EXPECT_EQ(events[0].nodes, 4);
+    EXPECT_EQ(root("D").text(), "1");
+}
+
+TEST(Main, ParallelParseBuildsTheSameTreeAsSequentialParse) {
+    std::string text =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<Employers xmlns:hr=\"urn:hr\" company=\"a > b\">\n";
+    for (size_t i = 0; i < 200; ++i) {
+        const auto id = std::to_string(i);
+        text +=
+            "  <Employer id=\"" + id + "\" note='x > y'>"
+            "<Name>Artem" + id + "</Name>"
+            "<!-- </Employer> -->"
+            "<hr:Salary><![CDATA[<" + id + ">]]></hr:Salary>"
+            "<Empty/>"
+            "</Employer>\n";
+        if (i % 7 == 0) {
+            text += "  <Separator/>\n";
+        }
+    }
+    text += "</Employers>\n";
+
+    const auto sequential = Node::fromString(std::string(text));
+    const auto parallel = Node::fromStringInParallel(std::string(text), true, nullptr, 4);
+
+    EXPECT_EQ(parallel["Employer"].size(), 200);
+    EXPECT_EQ(parallel["Separator"].size(), 29);
+    EXPECT_EQ(*parallel.attr("company"), "a > b");
+    EXPECT_EQ(parallel["Employer"][137]("Name").text(), "Artem137");
+    EXPECT_TRUE(parallel == sequential);
+}
+
+TEST(Main, ParallelParseFallsBackToSequentialParseForMixedContent) {
+    const auto text = "<Employers>Text<Employer>1</Employer><Employer>2</Employer></Employers>"s;
+
+    const auto sequential = Node::fromString(std::string(text));
+    const auto parallel = Node::fromStringInParallel(std::string(text), true, nullptr, 4);
+
+    EXPECT_TRUE(parallel == sequential);
+}
+
+TEST(Main, ParallelParseReportsErrorsOfAnyPart) {
+    std::string text = "<Employers>";
+    for (size_t i = 0; i < 100; ++i) {
+        text += i == 50 ? "<Employer><Name></Employer>" : "<Employer><Name/></Employer>";
+    }
+    text += "</Employers>";
+
+    EXPECT_THROW(Node::fromStringInParallel(text, true, nullptr, 4), Xml11Exception);
+}
+
+TEST(Main, ParallelParseRejectsWhatSequentialParseRejects) {
+    std::string children;
+    for (size_t i = 0; i < 100; ++i) {
+        children += "<Employer><Name/></Employer>";
+    }
+
+    const auto parse = [](const std::string& text, const size_t threads) {
+        try {
+            return threads
+                ? Node::fromStringInParallel(text, true, nullptr, threads).toString()
+                : Node::fromString(text).toString();
+        }
+        catch (const Xml11Exception&) {
+            return "error"s;
+        }
+    };
+
+    for (const auto& text : {
+            "<Employers>" + children + "</Wrong>",
+            "<Employers>" + children + "</Employers><Employer/>",
+            "<Employers>" + children + "</Employers>junk"}) {
+        EXPECT_EQ(parse(text, 4), parse(text, 0));
+#ifndef USE_XML11_RAPIDXML
+        EXPECT_EQ(parse(text, 4), "error");
+#endif
+    }
+
+    const auto valid = "<Employers>" + children + "</Employers >\n<!-- end --><?pi?>\n";
+    EXPECT_EQ(parse(valid, 4), parse(valid, 0));
+    EXPECT_NE(parse(valid, 4), "error");
+}
+
+TEST(Main, ParallelSerializationProducesTheSameTextAsSequentialSerialization) {
+    Node root {"Employers", {Node {"Version", "1", NodeType::ATTRIBUTE}}};
+    for (size_t i = 0; i < 100; ++i) {
+        root += Node {"Employer", {
+            Node {"Id", std::to_string(i), NodeType::ATTRIBUTE},
+            Node {"Name", "Employer " + std::to_string(i)},
+            Node {"Address", {Node {"City", "x > y & z"}}},
+        }};
+    }
+
+    for (const bool indent : {true, false}) {
+        EXPECT_EQ(root.toStringInParallel(indent, nullptr, 4), root.toString(indent));
+    }
+
+    root.text("Text");
+    EXPECT_EQ(root.toStringInParallel(true, nullptr, 4), root.toString(true));
+
+    EXPECT_EQ(Node {"Employers"}.toStringInParallel(true, nullptr, 4), Node {"Employers"}.toString(true));
+}
+
+TEST(Main, ParsingLeavesTheInputTextUntouched) {
+    const std::string text =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+        "<Employers Note=\"x &lt; y &amp; &quot;z&quot;\">"
+        "<Employer>Tom &amp; Jerry &#65;&#x42;</Employer>"
+        "</Employers>";
+    const auto copy = text;
+
+    for (size_t i = 0; i < 2; ++i) {
+        const auto root = Node::fromString(text);
+
+        EXPECT_EQ(text, copy);
+        EXPECT_EQ(root.name(), "Employers");
+        EXPECT_EQ(*root.attr("Note"), "x < y & \"z\"");
+        EXPECT_EQ(root("Employer").text(), "Tom & Jerry AB");
+    }
+}
+
+TEST(Main, CharacterReferencesToInvalidCharactersAreNotDecoded) {
+    EXPECT_EQ(Unescape("&#65;&#x1F600;&#9;"), "A\xF0\x9F\x98\x80\t");
+    EXPECT_EQ(Unescape("&#0;&#1;&#xD800;&#xDFFF;&#xFFFE;&#x110000;"), "&#0;&#1;&#xD800;&#xDFFF;&#xFFFE;&#x110000;");
+
+#ifndef USE_XML11_RAPIDXML
+    EXPECT_THROW(Node::fromString("<Root>&#xD800;</Root>"), Xml11Exception);
+    EXPECT_THROW(Node::fromString("<Root>&#0;</Root>"), Xml11Exception);
+#endif
+}
+
+TEST(Main, AttributeValuesAreEscapedOnlyWhereNeeded) {
+    const std::string dirty = "a long value with x < y & \"z\" > 'w' inside of it";
+    const std::string clean = "a long value with nothing to escape inside of it";
+
+    const Node root {"root", {
+        Node {"dirty", dirty, NodeType::ATTRIBUTE},
+        Node {"clean", clean, NodeType::ATTRIBUTE},
+    }};
+
+    const auto text = root.toString(false);
+    EXPECT_NE(text.find(clean), std::string::npos);
+    EXPECT_EQ(text.find(dirty), std::string::npos);
+
+    const auto parsed = Node::fromString(text);
+    EXPECT_EQ(*parsed.attr("dirty"), dirty);
+    EXPECT_EQ(*parsed.attr("clean"), clean);
+}
+
+TEST(Main, SlicesDescribeTheSerializedTextWithoutCopyingNodeTexts) {
+    auto root = GetEmployers();
+    root += Node {"Quote", "x > y & z", NodeType::ATTRIBUTE};
+    root += Node {"Blob", std::string(4096, 'x')};
+    root("Employers").text("Mixed");
+
+    for (const bool indent : {true, false}) {
+        const auto slices = root.toSlices(indent);
+        const auto text = slices.str();
+
+        EXPECT_EQ(slices.size(), text.size());
+#ifndef USE_XML11_RAPIDXML
+        EXPECT_EQ(text, root.toString(indent));
+#endif
+
+        const auto parsed = Node::fromString(text);
+        EXPECT_EQ(parsed("Blob").text(), root("Blob").text());
+        EXPECT_EQ(*parsed.attr("Quote"), "x > y & z");
+
+        const auto& blob = root("Blob").text();
+        EXPECT_TRUE(std::any_of(slices.slices().begin(), slices.slices().end(), [&blob](const Slice& slice) {
+            return slice.data == blob.data() and slice.size == blob.size();
+        }));
+    }
+}
+
+TEST(Main, BatchParseAndSerializeKeepTheOrderOfDocuments) {
+    std::vector<std::string> texts;
+    for (size_t i = 0; i < 50; ++i) {
+        texts.emplace_back("<Message><Id>" + std::to_string(i) + "</Id><Body>Text</Body></Message>");
+    }
+
+    const auto roots = parseBatch(texts, true, nullptr, 4);
+    ASSERT_EQ(roots.size(), texts.size());
+    for (size_t i = 0; i < roots.size(); ++i) {
+        EXPECT_EQ(roots[i]("Id").text(), std::to_string(i));
+    }
+
+    const auto results = serializeBatch(roots, false, nullptr, 4);
+    ASSERT_EQ(results.size(), roots.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        EXPECT_EQ(results[i], roots[i].toString(false));
+    }
+}
+
+TEST(Main, BatchParseReportsErrorsOfAnyDocument) {
+    std::vector<std::string> texts(20, "<Message><Id>1</Id></Message>");
+    texts[10] = "<Message><Id>1</Message>";
+
+    EXPECT_THROW(parseBatch(texts, true, nullptr, 4), Xml11Exception);
+    EXPECT_THROW(serializeBatch({Node {"Message"}, Node {}}), Xml11Exception);
+}
+
+TEST(Main, PlainParsesMayRunAlongsideABatch) {
+    const std::vector<std::string> texts(200, "<Message><Id>1</Id></Message>");
+
+    std::thread other {[] {
+        for (size_t i = 0; i < 200; ++i) {
+            const auto root = Node::fromString("<Message><Id>2</Id></Message>");
+            EXPECT_EQ(root("Id").text(), "2");
+            EXPECT_EQ(Node::fromString(root.toString())("Id").text(), "2");
+        }
+    }};
+
+    for (size_t i = 0; i < 5; ++i) {
+        for (const auto& root : parseBatch(texts, true, nullptr, 4)) {
+            EXPECT_EQ(root("Id").text(), "1");
+        }
+    }
+
+    other.join();
+}
+
+TEST(Main, RepeatedParsesOfDocumentsOfDifferentSizesStayCorrect) {
+    for (const size_t count : {1000, 10, 5000, 1}) {
+        std::string text = "<Messages>";
+        for (size_t i = 0; i < count; ++i) {
+            text += "<Message id=\"" + std::to_string(i) + "\">Text</Message>";
+        }
+        text += "</Messages>";
+
+        const auto root = Node::fromString(text);
+        ASSERT_EQ(root.nodes().size(), count);
+        EXPECT_EQ(root.nodes().back()("id").text(), std::to_string(count - 1));
+        EXPECT_EQ(Node::fromString(root.toString()).nodes().size(), count);
+    }
+
+#ifdef USE_XML11_RAPIDXML
+    // A value filter that parses on its own is given another document.
+    const auto root = Node::fromString(
+        "<Outer><Inner>1</Inner></Outer>",
+        true,
+        [](const std::string& value) {
+            return Node::fromString("<Value><Id>" + value + "</Id></Value>")("Id").text() + "!";
+        });
+    EXPECT_EQ(root("Inner").text(), "1!");
+#endif
+}
+
+#ifdef USE_XML11_RAPIDXML
+
+TEST(Main, PoolOptionsMayChangeWhileOtherThreadsParse) {
+    const auto defaults = poolOptions();
+    std::string text = "<Messages>";
+    for (size_t i = 0; i < 1000; ++i) {
+        text += "<Message id=\"" + std::to_string(i) + "\">Text</Message>";
+    }
+    text += "</Messages>";
+
+    std::thread parser {[&text] {
+        for (size_t i = 0; i < 50; ++i) {
+            EXPECT_EQ(Node::fromString(text).nodes().size(), 1000);
+        }
+    }};
+    for (size_t i = 0; i < 50; ++i) {
+        setPoolOptions({i % 2 ? 4096u : 128u * 1024, i % 2 ? 0u : 1024u * 1024});
+    }
+    parser.join();
+
+    setPoolOptions(defaults);
+    EXPECT_EQ(poolOptions().blockSize, defaults.blockSize);
+    EXPECT_EQ(poolOptions().maxRetainedBytes, defaults.maxRetainedBytes);
+}
+
+#endif
+
+TEST(Main, DeeplyNestedElementsAreAttachedToTheirParents) {
+    constexpr size_t depth = 2000;
+
+    std::string text;
+    for (size_t i = 0; i < depth; ++i) {
+        text += "<Level><Id>" + std::to_string(i) + "</Id>";
+    }
+    for (size_t i = 0; i < depth; ++i) {
+        text += "<Next/></Level>";
+    }
+
+    const auto root = Node::fromString(text);
+
+    auto node = root;
+    for (size_t i = 0; i < depth; ++i) {
+        ASSERT_EQ(node("Id").text(), std::to_string(i));
+        ASSERT_EQ(node.nodes().size(), i + 1 < depth ? 3 : 2);
+        EXPECT_EQ(node.nodes().back().name(), "Next");
+        if (i + 1 < depth) {
+            node = node("Level");
+        }
+    }
+}
+
+TEST(Main, CDataContentIsKeptWithoutItsMarkers) {
+    const auto root = Node::fromString(
+        "<Root>"
+        "<Script><![CDATA[if (a < b && c > d) {}]]></Script>"
+        "<Joined><![CDATA[one]]><![CDATA[two]]></Joined>"
+        "</Root>");
+
+    EXPECT_EQ(root("Script").type(), NodeType::CDATA);
+    EXPECT_EQ(root("Script").text(), "if (a < b && c > d) {}");
+    EXPECT_EQ(root("Joined").type(), NodeType::CDATA);
+    EXPECT_EQ(root("Joined").text(), "onetwo");
+
+    const auto copy = Node::fromString(root.toString());
+    EXPECT_TRUE(copy == root);
+    EXPECT_NE(root.toString(false).find("<Script><![CDATA[if (a < b && c > d) {}]]></Script>"), std::string::npos);
+}
+
+TEST(Main, MixedTextAndCDataReadAsTheyAlwaysHave) {
+    const auto root = Node::fromString(
+        "<Root>"
+        "<Mixed>a &amp; b<![CDATA[<c>]]></Mixed>"
+        "<Trailing><![CDATA[x]]>y &lt; z</Trailing>"
+        "<Split>1<![CDATA[2]]><Child/>3<![CDATA[4]]></Split>"
+        "</Root>");
+
+    EXPECT_EQ(root("Mixed").type(), NodeType::ELEMENT);
+    EXPECT_EQ(root("Mixed").text(), "a & b<![CDATA[<c>]]>");
+    EXPECT_EQ(root("Trailing").type(), NodeType::ELEMENT);
+    EXPECT_EQ(root("Trailing").text(), "<![CDATA[x]]>y < z");
+    EXPECT_EQ(root("Split").text(), "1<![CDATA[2]]>3<![CDATA[4]]>");
+}
+
+TEST(Main, CDataAndRawNodesAreWrittenVerbatim) {
+    const Node root {"Root", {
+        Node {"Script", "a]]>b", NodeType::CDATA},
+        Node {"Markup", "<b>bold</b> &amp; more", NodeType::RAW},
+    }};
+
+    const auto text = root.toString(false);
+    EXPECT_NE(text.find("<Script><![CDATA[a]]]]><![CDATA[>b]]></Script>"), std::string::npos);
+    EXPECT_NE(text.find("<Markup><b>bold</b> &amp; more</Markup>"), std::string::npos);
+#ifndef USE_XML11_RAPIDXML
+    EXPECT_EQ(root.toSlices(false).str(), text);
+#endif
+
+    const auto copy = Node::fromString(text);
+    EXPECT_EQ(copy("Script").text(), "a]]>b");
+    EXPECT_EQ(copy("Markup")("b").text(), "bold");
+}
+
+TEST(Main, LookupsByElementTypeFindCDataAndRawElements) {
+    const auto root = Node::fromString(
+        "<Root a=\"1\">"
+        "<Script><![CDATA[code]]></Script>"
+        "<Mixed>a<![CDATA[b]]></Mixed>"
+        "<Plain>c</Plain>"
+        "</Root>");
+
+    const auto elements = root[NodeType::ELEMENT];
+    ASSERT_EQ(elements.size(), 3U);
+    EXPECT_EQ(elements[0].name(), "Script");
+    EXPECT_EQ(elements[1].name(), "Mixed");
+    EXPECT_EQ(elements[2].name(), "Plain");
+    EXPECT_EQ(root(NodeType::ELEMENT).name(), "Script");
+    EXPECT_TRUE(root("Script").isElement());
+    EXPECT_FALSE(root("a").isElement());
+
+    EXPECT_EQ(root[NodeType::CDATA].size(), 1U);
+
+    const Node built {"Root", {
+        Node {"Markup", "<b/>", NodeType::RAW},
+        Node {"Plain", "c"},
+    }};
+    EXPECT_EQ(built(NodeType::ELEMENT).name(), "Markup");
+    EXPECT_EQ(built(NodeType::RAW).name(), "Markup");
+    EXPECT_EQ(built[NodeType::ELEMENT].size(), 2U);
+}
+
+TEST(Main, BuiltInFiltersChangeValuesInPlace) {
+    const auto apply = [](const auto& filter, std::string value) {
+        filter(value);
+        return value;
+    };
+
+    EXPECT_EQ(apply(Trim {}, "  \t value with  spaces \r\n"), "value with  spaces");
+    EXPECT_EQ(apply(Trim {}, " \n "), "");
+    EXPECT_EQ(apply(CollapseWhitespace {}, "  a long\t\tvalue \n split   over lines "), "a long value split over lines");
+    EXPECT_EQ(apply(CollapseWhitespace {}, "nothing_to_collapse_here"), "nothing_to_collapse_here");
+    EXPECT_EQ(apply(RemoveControlChars {}, std::string {"a\x01 long\x7F value\tkept\x1F\x00!", 22}), "a long value\tkept!");
+    EXPECT_EQ(apply(RemoveControlChars {}, "\x02"), "");
+    EXPECT_EQ(apply(chain(RemoveControlChars {}, CollapseWhitespace {}), " a\x03 \x04 b "), "a b");
+}
+
+TEST(Main, InPlaceFiltersAreAppliedWhileParsingAndWriting) {
+    const std::string text = "<Root Id=\"  1 \"><Name>\n  John \t Smith\n</Name></Root>";
+
+    const auto root = Node::fromString(text, true, CollapseWhitespace {});
+    EXPECT_EQ(root("Id").text(), "1");
+    EXPECT_EQ(root("Name").text(), "John Smith");
+
+    const auto upper = [](std::string& value) {
+        for (auto& c : value) {
+            c = static_cast<char>(::toupper(static_cast<unsigned char>(c)));
+        }
+    };
+    const ValueFilter toUpper = [&upper](const std::string& value) {
+        auto result = value;
+        upper(result);
+        return result;
+    };
+
+    EXPECT_TRUE(Node::fromString(text, true, upper) == Node::fromString(text, true, toUpper));
+    EXPECT_EQ(root.toString(false, upper), root.toString(false, toUpper));
+    EXPECT_EQ(root("Name").text(), "John Smith");
+#ifndef USE_XML11_RAPIDXML
+    EXPECT_EQ(root.toSlices(false, upper).str(), root.toString(false, upper));
+#endif
+}
+
+TEST(Main, DocumentsInLegacyEncodingsAreConvertedAsAWhole) {
+    const std::string windows1251 = "\xCF\xF0\xE8\xE2\xE5\xF2, \xEC\xE8\xF0";
+    const std::string koi8r = "\xF0\xD2\xC9\xD7\xC5\xD4, \xCD\xC9\xD2";
+
+    const auto root = Node::fromString(
+        "<?xml version=\"1.0\" encoding=\"windows-1251\"?>"
+        "<Root Name=\"" + windows1251 + "\"><Text>" + windows1251 + "</Text></Root>",
+        Encoding::WINDOWS_1251);
+    EXPECT_EQ(root("Name").text(), "Привет, мир");
+    EXPECT_EQ(root("Text").text(), "Привет, мир");
+
+    const auto text = root.toString(Encoding::KOI8_R, false);
+    EXPECT_EQ(text.find("<?xml version=\"1.0\" encoding=\"KOI8-R\"?>"), 0);
+    EXPECT_NE(text.find("<Text>" + koi8r + "</Text>"), std::string::npos);
+    EXPECT_TRUE(Node::fromString(text, Encoding::KOI8_R) == root);
+    EXPECT_EQ(root.toString(Encoding::UTF8), root.toString());
+
+    EXPECT_THROW(Node::fromString("<Root>\x98</Root>", Encoding::WINDOWS_1251), Xml11Exception);
+    EXPECT_THROW((Node {"Root", "€"}).toString(Encoding::KOI8_R), Xml11Exception);
+    EXPECT_NE((Node {"Root", "€"}).toString(Encoding::WINDOWS_1251, false).find("<Root>\x88</Root>"), std::string::npos);
+}
+
+TEST(Main, TypedValuesAreReadAndWrittenWithoutStreams) {
+    const auto root = Node::fromString(
+        "<Root Count=\" 42 \" Ratio=\"0.25\" Flag=\"true\">"
+        "<Negative>-7</Negative><Big>18446744073709551615</Big><Word>4x</Word><Empty/>"
+        "</Root>");
+
+    EXPECT_EQ(root("Count").as<int>(), 42);
+    EXPECT_EQ(root("Ratio").as<double>(), 0.25);
+    EXPECT_TRUE(root("Flag").as<bool>());
+    EXPECT_EQ(root("Negative").as<long>(), -7);
+    EXPECT_EQ(root("Big").as<uint64_t>(), 18446744073709551615ULL);
+    EXPECT_FALSE(root("Big").tryAs<int>());
+    EXPECT_FALSE(root("Negative").tryAs<unsigned>());
+    EXPECT_FALSE(root("Word").tryAs<int>());
+    EXPECT_FALSE(root("Empty").tryAs<double>());
+    EXPECT_THROW(root("Word").as<int>(), Xml11Exception);
+
+    const Node built {"Root", {
+        Node {"Int", -15},
+        Node {"Double", 0.1},
+        Node {"Bool", true},
+        Node {"Optional", std::optional<int> {7}, NodeType::OPTIONAL},
+    }};
+    EXPECT_EQ(built("Int").text(), "-15");
+    EXPECT_EQ(built("Double").text(), "0.1");
+    EXPECT_EQ(built("Bool").text(), "1");
+    EXPECT_EQ(built("Optional").text(), "7");
+    EXPECT_EQ(built("Double").as<double>(), 0.1);
+    EXPECT_TRUE(built("Bool").as<bool>());
+
+    Node node {"Root"};
+    node.addNode("Value", 123456789012LL);
+    EXPECT_EQ(node("Value").as<long long>(), 123456789012LL);
+}
+
+TEST(Main, NodeImplHoldsOnlyTheNameTheTextTwoListsAndTheType) {
+    EXPECT_LE(sizeof(NodeImpl), sizeof(NodeName) + sizeof(std::string) + 3 * sizeof(void*));
+#if defined(__x86_64__) && defined(__GLIBCXX__)
+#ifdef USE_XML11_NAME_TABLE
+    EXPECT_EQ(sizeof(NodeImpl), 64);
+#else
+    EXPECT_EQ(sizeof(NodeImpl), 88);
+#endif
+#endif
+}
+
+TEST(Main, NumbersAreFormattedWhenTheyAreSet) {
+    const Node root {"Root", {
+        Node {"Id", 7, NodeType::ATTRIBUTE},
+        Node {"Int", 42},
+        Node {"Double", 2.5},
+        Node {"Bool", false},
+        Node {"Max", std::numeric_limits<uint64_t>::max()},
+    }};
+
+    const auto text = root.toString(false);
+    EXPECT_NE(text.find(
+        "<Root Id=\"7\"><Int>42</Int><Double>2.5</Double><Bool>0</Bool><Max>18446744073709551615</Max></Root>"),
+        std::string::npos);
+#ifndef USE_XML11_RAPIDXML
+    EXPECT_EQ(root.toSlices(false).str(), text);
+#endif
+    EXPECT_TRUE(Node::fromString(text) == root);
+
+    EXPECT_EQ(root("Int").as<int>(), 42);
+    EXPECT_EQ(root("Int").as<double>(), 42.0);
+    EXPECT_EQ(root("Id").as<unsigned char>(), 7);
+    EXPECT_FALSE(root("Double").tryAs<int>());
+    EXPECT_FALSE(root("Bool").as<bool>());
+    EXPECT_FALSE((Node {"Big", 1000}).tryAs<int8_t>());
+    EXPECT_EQ(root("Max").as<uint64_t>(), std::numeric_limits<uint64_t>::max());
+
+    root("Int").text() += "0";
+    EXPECT_EQ(root("Int").as<int>(), 420);
+    auto node = root("Double");
+    node.value(true);
+    EXPECT_EQ(root("Double").text(), "1");
+}
+
+TEST(Main, NumbersMayBeReadByManyThreads) {
+    Node root {"Root"};
+    for (int i = 0; i < 100; ++i) {
+        root.addNode("Value", i);
+    }
+    const Node& tree = root;
+    const auto expected = tree.toString();
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&tree, &expected] {
+            EXPECT_EQ(tree.toString(), expected);
+            int sum = 0;
+            for (const auto& node : tree.nodes()) {
+                EXPECT_EQ(node.text(), std::to_string(node.as<int>()));
+                sum += node.as<int>();
+            }
+            EXPECT_EQ(sum, 4950);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+TEST(Main, LazyParsingBuildsAChildOnlyWhenItIsRead) {
+    const auto text = GetText();
+    const auto root = Node::fromStringLazily(text);
+
+    EXPECT_TRUE(root == Node::fromString(text));
+    EXPECT_EQ(root.toString(), Node::fromString(text).toString());
+    EXPECT_EQ(root("info")("author").text(), "John Fleck");
+    EXPECT_EQ(root("INFO")("Author").text(), "John Fleck");
+
+    const auto copy = Node::fromStringLazily(text);
+    auto nodes = copy.nodes();
+    EXPECT_EQ(nodes.size(), root.nodes().size());
+    nodes[0].text("Changed");
+    EXPECT_EQ(copy.nodes()[0].text(), "Changed");
+
+    const auto mixed = Node::fromStringLazily("<Root>text<A>1</A></Root>");
+    EXPECT_EQ(mixed.text(), "text");
+    EXPECT_EQ(mixed("A").text(), "1");
+
+    const auto broken = Node::fromStringLazily("<Root><A><B></C></A><D>1</D></Root>");
+    EXPECT_EQ(broken("D").text(), "1");
+    EXPECT_THROW(broken("A")("B"), Xml11Exception);
+}
+
+TEST(Main, LazyParsingRejectsWhatParsingRejects) {
+    for (const auto* text : {
+            "<Root><A/></Wrong>",
+            "<Root/>junk<X/>",
+            "<Root><A/></Root>junk"}) {
+        EXPECT_THROW(Node::fromString(text), Xml11Exception) << text;
+        EXPECT_THROW(Node::fromStringLazily(text), Xml11Exception) << text;
+    }
+
+    const auto root = Node::fromStringLazily("<Root><A>1</A></Root><!-- trailer -->\n");
+    EXPECT_EQ(root("A").text(), "1");
+
+    const auto broken = Node::fromStringLazily("<Root><A><B></C></A></Root>");
+    EXPECT_THROW(broken.toString(false, nullptr, true), Xml11Exception);
+    EXPECT_EQ(root.toString(false, nullptr, true), root.toString(false));
+}
+
+TEST(Main, AMalformedLazyChildThrowsFromEveryRead) {
+    const auto root = Node::fromStringLazily("<Root><A><B></C></A><D>1</D></Root>");
+    const Node& child = root("A");
+
+    EXPECT_THROW(child.attr("x"), Xml11Exception);
+    EXPECT_THROW((void) !!child, Xml11Exception);
+    EXPECT_THROW((void) (child == child), Xml11Exception);
+    EXPECT_THROW((void) (child != root("D")), Xml11Exception);
+    EXPECT_THROW(root.findNodeXPath("A/B"), Xml11Exception);
+    EXPECT_THROW((void) (root == root), Xml11Exception);
+    EXPECT_EQ(root("D").text(), "1");
+}
+
+TEST(Main, TheTypeOfALazyChildIsKnownWithoutParsingIt) {
+    const std::string text = "<Root><A><B></C></A><D>1</D><E><![CDATA[x]]></E></Root>";
+    const auto root = Node::fromStringLazily(text);
+
+    EXPECT_EQ(root.findNodes(NodeType::ELEMENT).size(), 3);
+    EXPECT_TRUE(root("A").isElement());
+    EXPECT_EQ(root("A").type(), NodeType::ELEMENT);
+    EXPECT_EQ(root.findNode(NodeType::CDATA).name(), "E");
+    EXPECT_EQ(root("E").type(), Node::fromString("<Root><E><![CDATA[x]]></E></Root>")("E").type());
+    EXPECT_THROW(root("A").text(), Xml11Exception);
+}
+
+TEST(Main, LazyChildrenMayBeReadAlongsideOtherParsesAndWrites) {
+    std::string text = "<Root>";
+    for (size_t i = 0; i < 200; ++i) {
+        text += "<Message><Id>" + std::to_string(i) + "</Id></Message>";
+    }
+    text += "</Root>";
+    const auto expected = Node::fromString(text).toString();
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < 4; ++i) {
+        threads.emplace_back([&text, &expected] {
+            const auto root = Node::fromStringLazily(text);
+            EXPECT_EQ(root.toString(), expected);
+            EXPECT_EQ(parseBatch({text, text}, true, nullptr, 2)[1].nodes().size(), 200U);
+            EXPECT_EQ(Node::fromStringLazily(text).nodes()[199]("Id").text(), "199");
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+TEST(Main, TapeDocumentAnswersTheQueriesOfNode) {
+    const auto text = GetText();
+    const auto document = TapeDocument::fromString(text);
+    const auto root = document.root();
+    const auto node = Node::fromString(text);
+
+    std::function<void (const TapeNode&, const Node&)> expectSame = [&](const TapeNode& tape, const Node& tree) {
+        EXPECT_EQ(tape.name(), tree.name());
+        EXPECT_EQ(tape.text(), tree.text());
+        EXPECT_EQ(tape.type(), tree.type());
+        const auto tapeNodes = tape.nodes();
+        const auto treeNodes = tree.nodes();
+        ASSERT_EQ(tapeNodes.size(), treeNodes.size());
+        for (size_t i = 0; i < tapeNodes.size(); ++i) {
+            expectSame(tapeNodes[i], treeNodes[i]);
+        }
+    };
+    expectSame(root, node);
+
+    EXPECT_EQ(root("info")("author").text(), "John Fleck");
+    EXPECT_EQ(root("INFO")("Author").text(), "John Fleck");
+    EXPECT_EQ(root("info")("id1").text(), "123456789");
+    EXPECT_EQ(root("info")(NodeType::ATTRIBUTE).name(), "id1");
+    EXPECT_EQ(root("info")("id2").as<int>(), 555);
+    EXPECT_EQ(root["ebook"].size(), 2);
+    EXPECT_EQ(root.findNodesXPath("body/para").size(), 3);
+    EXPECT_EQ(root.findNodesXPath("body/para")[2].text(), "Para3");
+    EXPECT_EQ(root.findNodeXPath("body/nested1/nested2").text(), node.findNodeXPath("body/nested1/nested2").text());
+    EXPECT_FALSE(root("missing")("author"));
+    EXPECT_TRUE(root("missing")("author").text().empty());
+    EXPECT_FALSE(root.findNodeXPath("body/missing/para"));
+    EXPECT_FALSE(TapeDocument::fromString(text, false).root()("INFO"));
+
+    const auto decoded = TapeDocument::fromString(
+        "<Root a=\"1 &amp;&#x41;\">x &lt; y<B>b<C/>c</B><![CDATA[<z>]]>w<!-- comment --></Root>");
+    EXPECT_EQ(decoded.root().text(), "x < y<z>w");
+    EXPECT_EQ(decoded.root()("a").text(), "1 &A");
+    EXPECT_EQ(decoded.root()("B").text(), "bc");
+    EXPECT_EQ(decoded.size(), 4);
+
+    EXPECT_THROW(TapeDocument::fromString("<a><b></a>"), Xml11Exception);
+    EXPECT_THROW(TapeDocument::fromString("<a>"), Xml11Exception);
+    EXPECT_THROW(TapeDocument::fromString("text<a/>"), Xml11Exception);
+    EXPECT_THROW(TapeDocument::fromString("<a x=1/>"), Xml11Exception);
+}
+
+TEST(Main, TapeDocumentRejectsBadNamesAttributesAndReferences) {
+    for (const auto* text : {
+            "<a>&foo;</a>",
+            "<a>x & y</a>",
+            "<a b='&#0;'/>",
+            "<a b='&#xD800;'/>",
+            "<a b='1' b='2'/>",
+            "<1a/>",
+            "<a 1b='1'/>",
+            "<a/b/>",
+            "<-a/>"}) {
+#ifndef USE_XML11_RAPIDXML
+        EXPECT_THROW(Node::fromString(text), Xml11Exception) << text;
+#endif
+        EXPECT_THROW(TapeDocument::fromString(text), Xml11Exception) << text;
+    }
+
+    const auto document = TapeDocument::fromString("<a:b _c='&#65;' d.e-1='&#x20AC;'><\xC3\xA9t\xC3\xA9/></a:b>");
+    EXPECT_EQ(document.root()("_c").text(), "A");
+    EXPECT_EQ(document.root()("d.e-1").text(), "\xE2\x82\xAC");
+    EXPECT_TRUE(document.root()("\xC3\xA9t\xC3\xA9"));
+}
+
+TEST(Main, TapeDocumentTypesCDataElementsAsNodeDoes) {
+    const std::string text =
+        "<Root a=\"1\">"
+        "<Script><![CDATA[if (a < b) {}]]></Script>"
+        "<Joined><![CDATA[one]]><![CDATA[two]]></Joined>"
+        "<Mixed>a &amp; b<![CDATA[<c>]]></Mixed>"
+        "<Plain>d</Plain>"
+        "</Root>";
+    const auto document = TapeDocument::fromString(text);
+    const auto root = document.root();
+    const auto node = Node::fromString(text);
+
+    for (const auto* name : {"Script", "Joined"}) {
+        EXPECT_EQ(root(name).type(), NodeType::CDATA);
+        EXPECT_EQ(root(name).type(), node(name).type());
+        EXPECT_EQ(root(name).text(), node(name).text());
+    }
+    EXPECT_EQ(root("Mixed").type(), NodeType::ELEMENT);
+    EXPECT_EQ(root("Mixed").text(), "a & b<c>");
+    EXPECT_EQ(root("Plain").type(), NodeType::ELEMENT);
+
+    EXPECT_EQ(root[NodeType::ELEMENT].size(), node[NodeType::ELEMENT].size());
+    EXPECT_EQ(root[NodeType::CDATA].size(), 2U);
+    EXPECT_EQ(root(NodeType::ELEMENT).name(), "Script");
+    EXPECT_TRUE(root("Script").isElement());
+    EXPECT_FALSE(root("a").isElement());
+}
+
+#ifdef USE_XML11_STATS
+
+TEST(Main, ParsingStaysUnderItsAllocationCeiling) {
+    const auto text = GetText();
+    stats().reset();
+
+    const auto root = Node::fromString(text);
+
+    EXPECT_EQ(stats().parse.calls, 1);
+    EXPECT_EQ(stats().parse.nodes, 18);
+    EXPECT_LE(stats().parse.allocations, 64);
+}
+
+TEST(Main, FindingANodeByNameDoesNotAllocate) {
+    const auto root = Node::fromString(GetText());
+    stats().reset();
+
+    const auto author = root("info")("author");
+
+    EXPECT_EQ(author.text(), "John Fleck");
+    EXPECT_EQ(stats().find.calls, 2);
+    EXPECT_EQ(stats().find.allocations, 0);
+    EXPECT_EQ(stats().find.refcounts, 0);
+}
+
+TEST(Main, BuildingANodeDeclarativelyStaysUnderItsAllocationCeiling) {
+    stats().reset();
+
+    const Node root {"Employer", {
+            {"id", "1", NodeType::ATTRIBUTE},
+            {"Name", "Artem"},
+            {"Address", {
+                {"City", "Moscow"},
+            }},
+        }};
+
+    EXPECT_EQ(stats().build.nodes, 5);
+    EXPECT_LE(stats().build.allocations, 32);
+}
+
+TEST(Main, SerializationStaysUnderItsAllocationCeiling) {
+    const auto root = Node::fromString(GetText());
+    stats().reset();
+
+    const auto text = root.toString();
+
+    EXPECT_EQ(stats().serialize.calls, 1);
+    EXPECT_EQ(stats().serialize.nodes, 0);
+    EXPECT_LE(stats().serialize.allocations, 8);
+}
+
+TEST(Main, LazyParsingDoesNotBuildTheChildrenThatAreNotRead) {
+    const auto text = GetText();
+    stats().reset();
+
+    const auto root = Node::fromStringLazily(text);
+    const auto nodes = stats().parse.nodes;
+    const auto author = root("info")("author");
+
+    EXPECT_EQ(author.text(), "John Fleck");
+    EXPECT_LT(nodes, 18);
+    EXPECT_LT(stats().parse.nodes, 18);
+}
+
+TEST(Main, TapeDocumentParsesWithFewAllocationsAndFindsWithoutAny) {
+    auto text = GetText();
+    stats().reset();
+
+    const auto document = TapeDocument::fromString(std::move(text));
+
+    EXPECT_EQ(stats().parse.nodes, 0);
+    EXPECT_LE(stats().parse.allocations, 8);
+
+    stats().reset();
+    const auto author = document.root()("info")("author");
+
+    EXPECT_EQ(author.text(), "John Fleck");
+    EXPECT_EQ(stats().find.allocations, 0);
+}
+
+#endif
+
 // void test_fn1()
 // {
 //     using namespace xml11;
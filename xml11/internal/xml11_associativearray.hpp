@@ -1,7 +1,9 @@
 #pragma once
 
 #include "xml11_utils.hpp"
+#include "xml11_nametable.hpp"
 
+#include <algorithm>
 #include <memory>
 
 namespace xml11 {
@@ -16,27 +18,31 @@ public:
     using ThisType = AssociativeArray<T>;
 
 public:
-    inline AssociativeArray(const bool isCaseInsensitive = true)
-        noexcept(noexcept(ValuesListT()))
-        : m_data{}, m_isCaseInsensitive{isCaseInsensitive}
+    AssociativeArray() = default;
+    AssociativeArray(AssociativeArray&& arr) = default;
+    AssociativeArray& operator = (AssociativeArray&& arr) = default;
+
+    inline AssociativeArray(std::initializer_list<T>&& list)
+    {
+        for (auto&& p : std::move(list)) {
+            data().emplace_back(std::make_shared<T>(std::move(p)));
+        }
+    }
+
+    inline AssociativeArray(const AssociativeArray& arr)
+        : m_data {arr.m_data ? std::make_unique<ValuesListT>(*arr.m_data) : nullptr}
     {
 
     }
 
-    inline AssociativeArray(std::initializer_list<T>&& list, const bool isCaseInsensitive = true)
-        noexcept(noexcept(ValuesListT()))
-        : m_isCaseInsensitive{isCaseInsensitive}
+    inline AssociativeArray& operator = (const AssociativeArray& arr)
     {
-        for (auto&& p : std::move(list)) {
-            m_data.emplace_back(std::make_shared<T>(std::move(p)));
+        if (this != &arr) {
+            m_data = arr.m_data ? std::make_unique<ValuesListT>(*arr.m_data) : nullptr;
         }
+        return *this;
     }
 
-    AssociativeArray(const AssociativeArray& arr) = default;
-    AssociativeArray(AssociativeArray&& arr) = default;
-    AssociativeArray& operator = (const AssociativeArray& arr) = default;
-    AssociativeArray& operator = (AssociativeArray&& arr) = default;
-
 public:
 
     /********************************************************************************
@@ -53,13 +59,9 @@ public:
         >,
         class = void
     >
-    inline void insert(T1&& name, T2&& value) noexcept
+    inline ValuePointerT& insert(T1&& name, T2&& value)
     {
-        const auto& link = m_data.emplace_back(std::make_shared<T>(std::forward<T1>(name), std::forward<T2>(value)));
-
-        if (m_isCaseInsensitive) {
-            link->isCaseInsensitive(true);
-        }
+        return data().emplace_back(std::make_shared<T>(std::forward<T1>(name), std::forward<T2>(value)));
     }
 
     template<
@@ -72,13 +74,9 @@ public:
         class = void,
         class = void
     >
-    inline void insert(T2&& value) noexcept
+    inline ValuePointerT& insert(T2&& value)
     {
-        const auto& link = m_data.emplace_back(std::make_shared<T>(std::forward<T2>(value)));
-
-        if (m_isCaseInsensitive) {
-            link->isCaseInsensitive(true);
-        }
+        return data().emplace_back(std::make_shared<T>(std::forward<T2>(value)));
     }
 
     template<
@@ -92,74 +90,69 @@ public:
         class = void,
         class = void
     >
-    inline void insert(T2&& value) noexcept
+    inline ValuePointerT& insert(T2&& value)
     {
-        const auto& link = m_data.emplace_back(std::forward<T2>(value));
+        return data().emplace_back(std::forward<T2>(value));
+    }
 
-        if (m_isCaseInsensitive) {
-            link->isCaseInsensitive(true);
-        }
+    // Constructs the value where it is kept and gives it back, so that the
+    // caller can go on filling it in.
+    template <class... Args>
+    inline T& emplace(Args&&... args)
+    {
+        return *data().emplace_back(std::make_shared<T>(std::forward<Args>(args)...));
     }
 
     template <class T1>
     inline void erase(T1&& node) noexcept
     {
-        for (auto it = m_data.begin(); it != m_data.end(); ++it) {
+        if (not m_data) {
+            return;
+        }
+
+        for (auto it = m_data->begin(); it != m_data->end(); ++it) {
             if (*it and *it == node) {
-                m_data.erase(it);
+                m_data->erase(it);
                 break;
             }
         }
     }
 
-    inline const ValuesListT findNodes(const std::string& name) const noexcept
-    {
-        return const_cast<ThisType>(this)->findNodes(name);
-    }
+    /********************************************************************************
+     * Removes every value matching the predicate in one compaction pass, so
+     * dropping many children costs a single walk over the list.
+     ********************************************************************************/
 
-    inline const ValuesListT findNodes(std::string&& name) const noexcept
+    template <class Predicate>
+    inline size_t eraseIf(Predicate&& predicate)
     {
-        return const_cast<ThisType>(this)->findNodes(std::move(name));
+        if (not m_data) {
+            return 0;
+        }
+
+        const auto it = std::remove_if(m_data->begin(), m_data->end(), std::forward<Predicate>(predicate));
+        const auto count = static_cast<size_t>(std::distance(it, m_data->end()));
+        m_data->erase(it, m_data->end());
+        return count;
     }
 
-    inline ValuesListT findNodes(const std::string& name) noexcept
+    inline void clear() noexcept
     {
-        ValuesListT result;
-
-        if (m_isCaseInsensitive) {
-            const auto lowerName = xml11::to_lower_copy(name);
-            for (const auto& value : m_data) {
-                if (to_lower_copy(value->name()) == lowerName) {
-                    result.emplace_back(value);
-                }
-            }
-        }
-        else {
-            for (const auto& value : m_data) {
-                if (value->name() == name) {
-                    result.emplace_back(value);
-                }
-            }
-        }
-
-        return result;
+        m_data.reset();
     }
 
-    inline ValuesListT findNodes(std::string&& name) noexcept
+    template <class CasePolicy>
+    inline ValuesListT findNodes(const std::string& name) const noexcept
     {
         ValuesListT result;
 
-        if (m_isCaseInsensitive) {
-            xml11::to_lower_inplace(std::move(name));
-            for (const auto& value : m_data) {
-                if (to_lower_copy(value->name()) == name) {
-                    result.emplace_back(value);
-                }
-            }
+        if (empty()) {
+            return result;
         }
-        else {
-            for (const auto& value : m_data) {
-                if (value->name() == name) {
+
+        if (const auto key = CasePolicy::key(name); CasePolicy::isKnown(key)) {
+            for (const auto& value : *m_data) {
+                if (CasePolicy::matches(value->nodeName(), key)) {
                     result.emplace_back(value);
                 }
             }
@@ -168,51 +161,24 @@ public:
         return result;
     }
 
-    inline const ValuePointerT findNode(const std::string& name) const noexcept
-    {
-        return const_cast<ThisType>(this)->findNode(name);
-    }
-
-    inline const ValuePointerT findNode(std::string&& name) const noexcept
+    template <class CasePolicy>
+    inline ValuePointerT findNode(const std::string& name) const noexcept
     {
-        return const_cast<ThisType>(this)->findNode(std::move(name));
+        const auto* value = find<CasePolicy>(name);
+        return value ? *value : nullptr;
     }
 
-    inline ValuePointerT findNode(const std::string& name) noexcept
+    template <class CasePolicy>
+    inline const ValuePointerT* find(const std::string& name) const noexcept
     {
-        if (m_isCaseInsensitive) {
-            const auto lowerName = xml11::to_lower_copy(name);
-            for (const auto& value : m_data) {
-                if (to_lower_copy(value->name()) == lowerName) {
-                    return value;
-                }
-            }
-        }
-        else {
-            for (const auto& value : m_data) {
-                if (value->name() == name) {
-                    return value;
-                }
-            }
+        if (empty()) {
+            return nullptr;
         }
 
-        return nullptr;
-    }
-
-        inline ValuePointerT findNode(std::string&& name) noexcept
-    {
-        if (m_isCaseInsensitive) {
-            xml11::to_lower_inplace(std::move(name));
-            for (const auto& value : m_data) {
-                if (to_lower_copy(value->name()) == name) {
-                    return value;
-                }
-            }
-        }
-        else {
-            for (const auto& value : m_data) {
-                if (value->name() == name) {
-                    return value;
+        if (const auto key = CasePolicy::key(name); CasePolicy::isKnown(key)) {
+            for (const auto& value : *m_data) {
+                if (CasePolicy::matches(value->nodeName(), key)) {
+                    return &value;
                 }
             }
         }
@@ -220,108 +186,59 @@ public:
         return nullptr;
     }
 
-    /********************************************************************************
-     * Syntactic sugar.
-     ********************************************************************************/
-
-    inline const ValuePointerT operator() (const T& name) const noexcept
-    {
-        return const_cast<ThisType>(this)(std::forward<T>(name));
-    }
-
-    inline ValuePointerT operator() (const T& name) noexcept
-    {
-        return findNode(std::forward<T>(name));
-    }
-
-    inline const ValuesListT operator[] (const T& name) const noexcept
-    {
-        return findNodes(std::forward<T>(name));
-    }
-
-    inline ValuesListT operator[] (const T& name) noexcept
-    {
-        return findNodes(std::forward<T>(name));
-    }
-
     /********************************************************************************
      * Misc functions.
      ********************************************************************************/
 
-    inline iterator begin()
-        noexcept(noexcept(ValuesListT().begin()))
-    {
-        return m_data.begin();
-    }
-
-    inline iterator end()
-        noexcept(noexcept(ValuesListT().end()))
-    {
-        return m_data.end();
-    }
-
-    inline const_iterator begin() const
-        noexcept(noexcept(ValuesListT().begin()))
-    {
-        return m_data.begin();
-    }
-
-    inline const_iterator end() const
-        noexcept(noexcept(ValuesListT().end()))
+    inline iterator begin() noexcept
     {
-        return m_data.end();
+        return m_data ? m_data->begin() : None().begin();
     }
 
-    inline size_t size() const
-        noexcept(noexcept(ValuesListT().size()))
+    inline iterator end() noexcept
     {
-        return m_data.size();
+        return m_data ? m_data->end() : None().end();
     }
 
-    inline bool empty() const
-        noexcept(noexcept(ValuesListT().empty()))
+    inline const_iterator begin() const noexcept
     {
-        return m_data.empty();
+        return nodes().begin();
     }
 
-    inline ValuePointerT& back()
-        noexcept(noexcept(ValuesListT().back()))
+    inline const_iterator end() const noexcept
     {
-        return m_data.back();
+        return nodes().end();
     }
 
-    inline const ValuePointerT& back() const
-        noexcept(noexcept(ValuesListT().back()))
+    inline size_t size() const noexcept
     {
-        return m_data.back();
+        return m_data ? m_data->size() : 0;
     }
 
-    inline ValuePointerT& front()
-        noexcept(noexcept(ValuesListT().front()))
+    inline bool empty() const noexcept
     {
-        return m_data.front();
+        return not m_data or m_data->empty();
     }
 
-    inline const ValuePointerT& front() const
-        noexcept(noexcept(ValuesListT().front()))
+    inline const ValuePointerT& back() const noexcept
     {
-        return m_data.front();
+        return m_data->back();
     }
 
-    inline ValuesListT& nodes() noexcept
+    inline const ValuePointerT& front() const noexcept
     {
-        return m_data;
+        return m_data->front();
     }
 
     inline const ValuesListT& nodes() const noexcept
     {
-        return m_data;
+        return m_data ? *m_data : None();
     }
 
     inline bool operator == (const AssociativeArray& right) const
         noexcept(noexcept(ValuesListT() == ValuesListT()))
     {
-        return right.m_data == m_data;
+        return right.nodes() == nodes();
     }
 
     inline bool operator != (const AssociativeArray& right) const
@@ -330,19 +247,29 @@ public:
         return not (*this == right);
     }
 
-    inline void isCaseInsensitive(const bool isCaseInsensitive) noexcept
+private:
+
+    /********************************************************************************
+     * Leaves are the majority of nodes, so the list is only allocated once the
+     * first child arrives and a leaf carries just a null pointer.
+     ********************************************************************************/
+
+    inline ValuesListT& data()
     {
-        m_isCaseInsensitive = isCaseInsensitive;
+        if (not m_data) {
+            m_data = std::make_unique<ValuesListT>();
+        }
+        return *m_data;
     }
 
-    inline bool isCaseInsensitive() const noexcept
+    static inline ValuesListT& None() noexcept
     {
-        return m_isCaseInsensitive;
+        static ValuesListT none;
+        return none;
     }
 
 private:
-    ValuesListT m_data;
-    bool m_isCaseInsensitive {true};
+    std::unique_ptr<ValuesListT> m_data {};
 };
 
 } // namespace xml11
\ No newline at end of file
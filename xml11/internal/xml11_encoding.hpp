@@ -0,0 +1,234 @@
+#pragma once
+
+#include "xml11_exceptions.hpp"
+#include "xml11_escape.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace xml11 {
+
+/********************************************************************************
+ * Legacy single-byte encodings.
+ *
+ * The tree always holds UTF-8. A document in another encoding is converted
+ * as a whole before it is parsed, and the text a serializer wrote is
+ * converted once afterwards, so no value is converted on its own. Both
+ * passes look at eight bytes at a time and copy runs of ASCII in one piece;
+ * only the bytes with the high bit set go through the table of the encoding.
+ *
+ * The encoding in the XML declaration is rewritten too, so the backend reads
+ * UTF-8 and the result names the encoding it is written in.
+ ********************************************************************************/
+
+enum class Encoding {
+    UTF8,
+    WINDOWS_1251,
+    KOI8_R,
+};
+
+namespace {
+
+// Code points of the bytes 0x80-0xFF. Zero marks a byte the encoding does
+// not define.
+using CodePage = std::array<uint16_t, 128>;
+
+static constexpr CodePage WINDOWS_1251_PAGE {
+    0x0402, 0x0403, 0x201A, 0x0453, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x20AC, 0x2030, 0x0409, 0x2039, 0x040A, 0x040C, 0x040B, 0x040F,
+    0x0452, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x0000, 0x2122, 0x0459, 0x203A, 0x045A, 0x045C, 0x045B, 0x045F,
+    0x00A0, 0x040E, 0x045E, 0x0408, 0x00A4, 0x0490, 0x00A6, 0x00A7,
+    0x0401, 0x00A9, 0x0404, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x0407,
+    0x00B0, 0x00B1, 0x0406, 0x0456, 0x0491, 0x00B5, 0x00B6, 0x00B7,
+    0x0451, 0x2116, 0x0454, 0x00BB, 0x0458, 0x0405, 0x0455, 0x0457,
+    0x0410, 0x0411, 0x0412, 0x0413, 0x0414, 0x0415, 0x0416, 0x0417,
+    0x0418, 0x0419, 0x041A, 0x041B, 0x041C, 0x041D, 0x041E, 0x041F,
+    0x0420, 0x0421, 0x0422, 0x0423, 0x0424, 0x0425, 0x0426, 0x0427,
+    0x0428, 0x0429, 0x042A, 0x042B, 0x042C, 0x042D, 0x042E, 0x042F,
+    0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437,
+    0x0438, 0x0439, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E, 0x043F,
+    0x0440, 0x0441, 0x0442, 0x0443, 0x0444, 0x0445, 0x0446, 0x0447,
+    0x0448, 0x0449, 0x044A, 0x044B, 0x044C, 0x044D, 0x044E, 0x044F,
+};
+
+static constexpr CodePage KOI8_R_PAGE {
+    0x2500, 0x2502, 0x250C, 0x2510, 0x2514, 0x2518, 0x251C, 0x2524,
+    0x252C, 0x2534, 0x253C, 0x2580, 0x2584, 0x2588, 0x258C, 0x2590,
+    0x2591, 0x2592, 0x2593, 0x2320, 0x25A0, 0x2219, 0x221A, 0x2248,
+    0x2264, 0x2265, 0x00A0, 0x2321, 0x00B0, 0x00B2, 0x00B7, 0x00F7,
+    0x2550, 0x2551, 0x2552, 0x0451, 0x2553, 0x2554, 0x2555, 0x2556,
+    0x2557, 0x2558, 0x2559, 0x255A, 0x255B, 0x255C, 0x255D, 0x255E,
+    0x255F, 0x2560, 0x2561, 0x0401, 0x2562, 0x2563, 0x2564, 0x2565,
+    0x2566, 0x2567, 0x2568, 0x2569, 0x256A, 0x256B, 0x256C, 0x00A9,
+    0x044E, 0x0430, 0x0431, 0x0446, 0x0434, 0x0435, 0x0444, 0x0433,
+    0x0445, 0x0438, 0x0439, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E,
+    0x043F, 0x044F, 0x0440, 0x0441, 0x0442, 0x0443, 0x0436, 0x0432,
+    0x044C, 0x044B, 0x0437, 0x0448, 0x044D, 0x0449, 0x0447, 0x044A,
+    0x042E, 0x0410, 0x0411, 0x0426, 0x0414, 0x0415, 0x0424, 0x0413,
+    0x0425, 0x0418, 0x0419, 0x041A, 0x041B, 0x041C, 0x041D, 0x041E,
+    0x041F, 0x042F, 0x0420, 0x0421, 0x0422, 0x0423, 0x0416, 0x0412,
+    0x042C, 0x042B, 0x0417, 0x0428, 0x042D, 0x0429, 0x0427, 0x042A,
+};
+
+// Code points with their bytes, sorted for the way back from UTF-8.
+using ReversePage = std::array<std::pair<uint16_t, unsigned char>, 128>;
+
+static inline ReversePage MakeReversePage(const CodePage& page) noexcept
+{
+    ReversePage result {};
+    for (size_t i = 0; i < page.size(); ++i) {
+        result[i] = {page[i], static_cast<unsigned char>(0x80 + i)};
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+static inline const CodePage& PageOf(const Encoding encoding) noexcept
+{
+    return encoding == Encoding::KOI8_R ? KOI8_R_PAGE : WINDOWS_1251_PAGE;
+}
+
+static inline const ReversePage& ReversePageOf(const Encoding encoding) noexcept
+{
+    static const ReversePage windows1251 = MakeReversePage(WINDOWS_1251_PAGE);
+    static const ReversePage koi8r = MakeReversePage(KOI8_R_PAGE);
+    return encoding == Encoding::KOI8_R ? koi8r : windows1251;
+}
+
+static inline std::string_view NameOf(const Encoding encoding) noexcept
+{
+    switch (encoding) {
+    case Encoding::WINDOWS_1251: return "windows-1251";
+    case Encoding::KOI8_R: return "KOI8-R";
+    default: return "UTF-8";
+    }
+}
+
+// Returns the position of the first byte with the high bit set at or after
+// pos, or the size of the text when there is none.
+static inline size_t FindNonAscii(const std::string_view text, size_t pos) noexcept
+{
+    for (; pos + sizeof(uint64_t) <= text.size(); pos += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, text.data() + pos, sizeof(word));
+        if (word & HIGH_BITS) {
+            break;
+        }
+    }
+
+    for (; pos < text.size(); ++pos) {
+        if (text[pos] & 0x80) {
+            return pos;
+        }
+    }
+
+    return text.size();
+}
+
+// Puts the name in place of the encoding the declaration gives, if any.
+static inline void ReplaceDeclaredEncoding(std::string& text, const std::string_view name)
+{
+    if (text.compare(0, 5, "<?xml") != 0) {
+        return;
+    }
+
+    const auto end = text.find("?>");
+    const auto attribute = text.find("encoding", 5);
+    if (end == std::string::npos or attribute == std::string::npos or attribute > end) {
+        return;
+    }
+
+    const auto open = text.find_first_of("\"'", attribute);
+    if (open == std::string::npos or open > end) {
+        return;
+    }
+    const auto close = text.find(text[open], open + 1);
+    if (close == std::string::npos or close > end) {
+        return;
+    }
+
+    text.replace(open + 1, close - open - 1, name);
+}
+
+} // anonymous namespace
+
+inline std::string ToUtf8(const std::string_view text, const Encoding encoding)
+{
+    if (encoding == Encoding::UTF8) {
+        return std::string {text};
+    }
+
+    const auto& page = PageOf(encoding);
+
+    std::string result;
+    result.reserve(text.size() + text.size() / 2);
+
+    size_t begin = 0;
+    for (size_t pos = FindNonAscii(text, 0); pos < text.size(); pos = FindNonAscii(text, begin)) {
+        result.append(text.data() + begin, pos - begin);
+
+        const auto code = page[static_cast<unsigned char>(text[pos]) - 0x80];
+        if (code == 0) {
+            throw Xml11Exception(
+                "Error! The byte " + std::to_string(static_cast<unsigned char>(text[pos])) +
+                " is not defined in " + std::string {NameOf(encoding)} + "!");
+        }
+        AppendUtf8(result, code);
+        begin = pos + 1;
+    }
+    result.append(text.data() + begin, text.size() - begin);
+
+    ReplaceDeclaredEncoding(result, NameOf(Encoding::UTF8));
+    return result;
+}
+
+inline std::string FromUtf8(const std::string_view text, const Encoding encoding)
+{
+    if (encoding == Encoding::UTF8) {
+        return std::string {text};
+    }
+
+    const auto& page = ReversePageOf(encoding);
+
+    std::string result;
+    result.reserve(text.size());
+
+    size_t begin = 0;
+    for (size_t pos = FindNonAscii(text, 0); pos < text.size(); pos = FindNonAscii(text, begin)) {
+        result.append(text.data() + begin, pos - begin);
+
+        // The encodings hold nothing beyond U+FFFF, so only two- and
+        // three-byte sequences have to be decoded.
+        const auto lead = static_cast<unsigned char>(text[pos]);
+        const auto length = lead >= 0xE0 ? 3 : 2;
+        uint32_t code = length == 3 ? lead & 0x0F : lead & 0x1F;
+        bool isValid = lead >= 0xC2 and lead < 0xF0 and pos + length <= text.size();
+        for (auto i = 1; isValid and i < length; ++i) {
+            const auto next = static_cast<unsigned char>(text[pos + i]);
+            isValid = (next & 0xC0) == 0x80;
+            code = (code << 6) | (next & 0x3F);
+        }
+
+        const auto found = std::lower_bound(
+            page.begin(), page.end(), std::pair<uint16_t, unsigned char> {static_cast<uint16_t>(code), 0});
+        if (not isValid or code < 0x80 or found == page.end() or found->first != code) {
+            throw Xml11Exception(
+                "Error! The character at " + std::to_string(pos) +
+                " can not be written in " + std::string {NameOf(encoding)} + "!");
+        }
+        result += static_cast<char>(found->second);
+        begin = pos + length;
+    }
+    result.append(text.data() + begin, text.size() - begin);
+
+    ReplaceDeclaredEncoding(result, NameOf(encoding));
+    return result;
+}
+
+} // namespace xml11
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace xml11 {
+
+namespace {
+
+/********************************************************************************
+ * Escaping of values.
+ *
+ * Most values are plain text, so writers first look for the characters that
+ * have to be replaced and copy every clean run in one piece. The search
+ * tests eight bytes at a time in a 64-bit word: for each special character
+ * the bytes equal to it become zero after a XOR, and the classic zero byte
+ * test finds them all at once. Only the word with a match is looked at byte
+ * by byte.
+ *
+ * Whether a value is clean is not cached on the node: Node::text() gives a
+ * mutable reference, so any cached bit could silently go stale.
+ *
+ * Unescape does the opposite for parsers that leave entities in place.
+ ********************************************************************************/
+
+static constexpr std::string_view ATTRIBUTE_SPECIALS = "<>&\"\n\r\t";
+
+static constexpr uint64_t LOW_BITS = 0x0101010101010101ULL;
+static constexpr uint64_t HIGH_BITS = 0x8080808080808080ULL;
+
+static inline uint64_t ZeroBytes(const uint64_t word) noexcept
+{
+    return (word - LOW_BITS) & ~word & HIGH_BITS;
+}
+
+// Returns the position of the first of the specials at or after pos, or the
+// size of the text when there is none.
+static inline size_t FindSpecial(
+    const std::string_view text,
+    const std::string_view specials,
+    size_t pos) noexcept
+{
+    for (; pos + sizeof(uint64_t) <= text.size(); pos += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, text.data() + pos, sizeof(word));
+
+        uint64_t found = 0;
+        for (const auto c : specials) {
+            found |= ZeroBytes(word ^ (LOW_BITS * static_cast<unsigned char>(c)));
+        }
+        if (found) {
+            break;
+        }
+    }
+
+    for (; pos < text.size(); ++pos) {
+        if (specials.find(text[pos]) != std::string_view::npos) {
+            return pos;
+        }
+    }
+
+    return text.size();
+}
+
+static inline bool NeedsEscaping(const std::string_view text, const std::string_view specials) noexcept
+{
+    return FindSpecial(text, specials, 0) != text.size();
+}
+
+// The entity function gives the replacement of every special character.
+template<class Entity>
+static inline void AppendEscaped(
+    std::string& out,
+    const std::string_view text,
+    const std::string_view specials,
+    Entity&& entity)
+{
+    size_t begin = 0;
+    for (size_t pos = FindSpecial(text, specials, 0); pos < text.size(); pos = FindSpecial(text, specials, begin)) {
+        out.append(text.data() + begin, pos - begin);
+        out += entity(text[pos]);
+        begin = pos + 1;
+    }
+    out.append(text.data() + begin, text.size() - begin);
+}
+
+static constexpr std::string_view TEXT_SPECIALS = "<>&";
+
+// Replacements libxml2 makes in attribute values.
+static inline std::string_view AttributeEntity(const char c) noexcept
+{
+    switch (c) {
+    case '<': return "&lt;";
+    case '>': return "&gt;";
+    case '&': return "&amp;";
+    case '"': return "&quot;";
+    case '\n': return "&#10;";
+    case '\r': return "&#13;";
+    case '\t': return "&#9;";
+    default: return {};
+    }
+}
+
+// A CDATA section ends at the first "]]>", so content holding one is
+// written as several sections split between the brackets and the '>'.
+template<class Function>
+static inline void ForEachCDataSection(const std::string_view content, Function&& section)
+{
+    size_t begin = 0;
+    for (auto pos = content.find("]]>"); pos != std::string_view::npos; pos = content.find("]]>", pos + 1)) {
+        section(content.substr(begin, pos + 2 - begin));
+        begin = pos + 2;
+    }
+    section(content.substr(begin));
+}
+
+static inline void AppendUtf8(std::string& out, const uint32_t code)
+{
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    }
+    else if (code < 0x800) {
+        out += static_cast<char>(0xC0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+    else if (code < 0x10000) {
+        out += static_cast<char>(0xE0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+    else {
+        out += static_cast<char>(0xF0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+// Whether XML allows the character at all: no NUL, no other C0 control
+// besides the whitespace, no surrogate, no U+FFFE or U+FFFF.
+static inline bool IsXmlChar(const uint32_t code) noexcept
+{
+    return code == 0x9 or code == 0xA or code == 0xD
+        or (code >= 0x20 and code <= 0xD7FF)
+        or (code >= 0xE000 and code <= 0xFFFD)
+        or (code >= 0x10000 and code <= 0x10FFFF);
+}
+
+// Returns false when the reference is not a character XML allows, so it is
+// kept as it is, the way unknown entities are.
+static inline bool AppendCharacterReference(std::string& out, const std::string_view digits)
+{
+    const bool isHex = not digits.empty() and digits[0] == 'x';
+    const auto number = isHex ? digits.substr(1) : digits;
+    if (number.empty()) {
+        return false;
+    }
+
+    uint32_t code = 0;
+    for (const auto c : number) {
+        uint32_t digit = 0;
+        if (c >= '0' and c <= '9') {
+            digit = c - '0';
+        }
+        else if (isHex and c >= 'a' and c <= 'f') {
+            digit = c - 'a' + 10;
+        }
+        else if (isHex and c >= 'A' and c <= 'F') {
+            digit = c - 'A' + 10;
+        }
+        else {
+            return false;
+        }
+        code = code * (isHex ? 16 : 10) + digit;
+        if (code > 0x10FFFF) {
+            return false;
+        }
+    }
+
+    if (not IsXmlChar(code)) {
+        return false;
+    }
+
+    AppendUtf8(out, code);
+    return true;
+}
+
+// Replaces the predefined entities and character references. Anything else
+// after an '&' is kept as it is, the way rapidxml translates them itself.
+static inline std::string Unescape(const std::string_view text)
+{
+    constexpr auto npos = std::string_view::npos;
+
+    auto pos = text.find('&');
+    if (pos == npos) {
+        return std::string {text};
+    }
+
+    std::string result;
+    result.reserve(text.size());
+
+    size_t begin = 0;
+    for (; pos != npos; pos = text.find('&', begin)) {
+        result.append(text.data() + begin, pos - begin);
+
+        const auto end = text.find(';', pos);
+        const auto entity = end == npos ? std::string_view {} : text.substr(pos + 1, end - pos - 1);
+
+        if (entity == "lt") {
+            result += '<';
+        }
+        else if (entity == "gt") {
+            result += '>';
+        }
+        else if (entity == "amp") {
+            result += '&';
+        }
+        else if (entity == "quot") {
+            result += '"';
+        }
+        else if (entity == "apos") {
+            result += '\'';
+        }
+        else if (entity.empty() or entity[0] != '#' or not AppendCharacterReference(result, entity.substr(1))) {
+            result += '&';
+            begin = pos + 1;
+            continue;
+        }
+
+        begin = end + 1;
+    }
+
+    result.append(text.data() + begin, text.size() - begin);
+    return result;
+}
+
+} // anonymous namespace
+
+} // namespace xml11
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "xml11_utils.hpp"
+#include "xml11_escape.hpp"
+
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+namespace xml11 {
+
+/********************************************************************************
+ * In-place value filters.
+ *
+ * A ValueFilter is a std::function that takes a copy of every value and
+ * returns a new string. An in-place filter is any object callable as
+ * void(std::string&): it changes the value it is given, so a parser applies
+ * it to the string it is about to store and a serializer to the one copy it
+ * writes. Passed as a template argument, the filter is inlined, and with no
+ * filter at all nothing is copied.
+ *
+ * The built-in filters test eight bytes at a time the way the escaping
+ * helpers do, so clean runs of a value are skipped a word at a time.
+ ********************************************************************************/
+
+template<class Filter, class = void>
+struct IsInPlaceFilter : std::false_type {};
+
+template<class Filter>
+struct IsInPlaceFilter<Filter, std::enable_if_t<
+    std::is_void<std::invoke_result_t<const Filter&, std::string&>>::value>> : std::true_type {};
+
+template<class Filter>
+using EnableIfInPlaceFilter = std::enable_if_t<IsInPlaceFilter<Filter>::value>;
+
+struct NoFilter final {
+    inline void operator() (std::string&) const noexcept
+    {
+    }
+};
+
+template<class Filter>
+static constexpr bool IS_NO_FILTER = std::is_same<Filter, NoFilter>::value;
+
+// Lets a ValueFilter go through the same code as the in-place filters.
+class FunctionFilter final {
+public:
+    inline explicit FunctionFilter(const ValueFilter& valueFilter) noexcept
+        : m_valueFilter {&valueFilter}
+    {
+    }
+
+    inline void operator() (std::string& value) const
+    {
+        value = (*m_valueFilter)(value);
+    }
+
+private:
+    const ValueFilter* m_valueFilter {nullptr};
+};
+
+// Calls the function with the in-place form of the value filter.
+template<class Function>
+inline decltype(auto) WithFilter(const ValueFilter& valueFilter, Function&& function)
+{
+    if (valueFilter) {
+        return function(FunctionFilter {valueFilter});
+    }
+    return function(NoFilter {});
+}
+
+// Serializers write a filtered copy and leave the tree as it is.
+template<class Filter>
+inline std::string FilteredCopy(const std::string& value, const Filter& filter)
+{
+    std::string result = value;
+    filter(result);
+    return result;
+}
+
+template<class... Filters>
+class FilterChain final {
+public:
+    inline explicit FilterChain(Filters... filters)
+        : m_filters {std::move(filters)...}
+    {
+    }
+
+    inline void operator() (std::string& value) const
+    {
+        std::apply([&value](const auto&... filter) { (filter(value), ...); }, m_filters);
+    }
+
+private:
+    std::tuple<Filters...> m_filters;
+};
+
+// Applies the filters one after another.
+template<class... Filters>
+inline FilterChain<Filters...> chain(Filters... filters)
+{
+    return FilterChain<Filters...> {std::move(filters)...};
+}
+
+namespace {
+
+static constexpr std::string_view WHITESPACE = " \t\n\r";
+
+static inline bool IsWhitespace(const char c) noexcept
+{
+    return c == ' ' or c == '\t' or c == '\n' or c == '\r';
+}
+
+// Control characters other than the whitespace XML allows, and DEL.
+static inline bool IsControl(const char c) noexcept
+{
+    const auto byte = static_cast<unsigned char>(c);
+    return (byte < 0x20 and not IsWhitespace(c)) or byte == 0x7F;
+}
+
+// Returns the position of the first control character at or after pos, or
+// the size of the text when there is none. A word is looked at byte by byte
+// only when one of its bytes is below 0x20 or is DEL.
+static inline size_t FindControl(const std::string_view text, size_t pos) noexcept
+{
+    for (; pos + sizeof(uint64_t) <= text.size(); pos += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, text.data() + pos, sizeof(word));
+
+        const auto below = (word - LOW_BITS * 0x20) & ~word & HIGH_BITS;
+        if (below | ZeroBytes(word ^ (LOW_BITS * 0x7F))) {
+            break;
+        }
+    }
+
+    for (; pos < text.size(); ++pos) {
+        if (IsControl(text[pos])) {
+            return pos;
+        }
+    }
+
+    return text.size();
+}
+
+} // anonymous namespace
+
+/********************************************************************************
+ * Built-in filters.
+ ********************************************************************************/
+
+// Removes whitespace from both ends.
+struct Trim final {
+    inline void operator() (std::string& value) const
+    {
+        const auto last = value.find_last_not_of(WHITESPACE);
+        if (last == std::string::npos) {
+            value.clear();
+            return;
+        }
+        value.erase(last + 1);
+        value.erase(0, value.find_first_not_of(WHITESPACE));
+    }
+};
+
+// Replaces every run of whitespace by one space and trims the ends, the
+// way XML Schema collapses a value.
+struct CollapseWhitespace final {
+    inline void operator() (std::string& value) const
+    {
+        size_t out = 0;
+        bool isAfterSpace = false;
+
+        for (size_t pos = 0; pos < value.size(); ) {
+            const auto next = FindSpecial(value, WHITESPACE, pos);
+            if (next > pos) {
+                if (isAfterSpace and out) {
+                    value[out++] = ' ';
+                }
+                std::memmove(&value[out], &value[pos], next - pos);
+                out += next - pos;
+            }
+
+            for (pos = next; pos < value.size() and IsWhitespace(value[pos]); ++pos) {
+            }
+            isAfterSpace = pos > next;
+        }
+
+        value.resize(out);
+    }
+};
+
+// Removes control characters, keeping tabs and line breaks.
+struct RemoveControlChars final {
+    inline void operator() (std::string& value) const
+    {
+        auto out = FindControl(value, 0);
+        if (out == value.size()) {
+            return;
+        }
+
+        for (auto pos = out + 1; pos < value.size(); ) {
+            const auto next = FindControl(value, pos);
+            std::memmove(&value[out], &value[pos], next - pos);
+            out += next - pos;
+            pos = next + 1;
+        }
+
+        value.resize(out);
+    }
+};
+
+} // namespace xml11
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "xml11_nodeimpl.hpp"
+#include "xml11_filters.hpp"
+#include "xml11_parallel.hpp"
+#include "xml11_exceptions.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace xml11 {
+
+/********************************************************************************
+ * Lazy parsing.
+ *
+ * A handler that reads a few children of a large document should not pay
+ * for building all the others. The structural scan of the parallel parser
+ * finds where each child of the root begins and ends; the root is parsed
+ * with its attributes alone, and every child becomes a node that knows only
+ * its name and its part of the text. The first access to anything else in
+ * a child parses that part, inside a copy of the root's start tag, and the
+ * result stays in the node.
+ *
+ * Finding a child of the root by name therefore parses nothing, and only
+ * the children that are descended into are built. The text is kept as long
+ * as any of its nodes, and a part that turns out to be malformed throws
+ * when it is first accessed. Documents the scan does not fully understand
+ * are parsed at once, the usual way.
+ ********************************************************************************/
+
+struct LazyDocument final {
+    std::string text {};
+    DocumentLayout layout {};
+};
+
+/********************************************************************************
+ * The lazy state lives in a node of its own type, so the nodes of every
+ * other document do not pay for it. The part is parsed once even when
+ * several threads ask for it at the same time, and a part that failed to
+ * parse throws again on the next access. Its type is ELEMENT unless
+ * the part holds CDATA sections, which only parsing can tell, so a type
+ * query parses nothing for all the other parts.
+ ********************************************************************************/
+
+class LazyNodeImpl final : public NodeImpl {
+public:
+    inline LazyNodeImpl(
+        const std::string_view name,
+        std::shared_ptr<const LazyDocument> document,
+        const std::string_view part)
+        : NodeImpl {name},
+          m_document {std::move(document)},
+          m_part {part},
+          m_mayHoldCData {part.find("<![CDATA[") != std::string_view::npos}
+    {
+        markLazy();
+    }
+
+    inline bool isParsed() const noexcept
+    {
+        return m_isParsed.load(std::memory_order_acquire);
+    }
+
+    inline void parse(const bool isTypeOnly) const
+    {
+        if (isParsed() or (isTypeOnly and not m_mayHoldCData)) {
+            return;
+        }
+
+        const std::lock_guard<std::mutex> lock {m_mutex};
+        if (isParsed()) {
+            return;
+        }
+        const auto root = ParseXmlPart(WrapInRoot(m_document->layout, m_part));
+        if (not root or root->nodes().size() != 1) {
+            throw Xml11Exception("Error! Failed to parse a part of the document! [LazyNodeImpl]");
+        }
+        const_cast<LazyNodeImpl*>(this)->takeContent(std::move(*root->nodes().front()), m_mayHoldCData);
+        m_isParsed.store(true, std::memory_order_release);
+    }
+
+private:
+    std::shared_ptr<const LazyDocument> m_document {nullptr};
+    std::string_view m_part {};
+    mutable std::mutex m_mutex {};
+    mutable std::atomic<bool> m_isParsed {false};
+    bool m_mayHoldCData {false};
+};
+
+inline bool IsLazyNodeParsed(const NodeImpl& node) noexcept
+{
+    return static_cast<const LazyNodeImpl&>(node).isParsed();
+}
+
+inline void ParseLazyNode(const NodeImpl& node, const bool isTypeOnly)
+{
+    static_cast<const LazyNodeImpl&>(node).parse(isTypeOnly);
+}
+
+// Called by the backends, which report the whole document as one parse.
+inline std::shared_ptr<NodeImpl> ParseXmlLazily(const std::string& text)
+{
+    auto document = std::make_shared<LazyDocument>();
+    document->text = text;
+
+    auto layout = ScanDocument(document->text);
+    if (not layout) {
+        return ParseXmlPart(text);
+    }
+    document->layout = std::move(*layout);
+
+    const auto root = ParseXmlPart(WrapInRoot(document->layout, {}));
+    if (not root) {
+        return nullptr;
+    }
+
+    for (const auto child : document->layout.children) {
+        const auto name = child.substr(1, child.find_first_of(" \t\r\n/>", 1) - 1);
+        root->addNode(std::make_shared<LazyNodeImpl>(name, document, child));
+    }
+
+    return root;
+}
+
+} // namespace xml11
@@ -2,13 +2,22 @@
 
 #include "xml11_nodetype.hpp"
 #include "xml11_nodeimpl.hpp"
+#include "xml11_observer.hpp"
+#include "xml11_parallel.hpp"
+#include "xml11_escape.hpp"
+#include "xml11_filters.hpp"
 
 #include <libxml/xmlreader.h>
 #include <libxml/xmlwriter.h>
 
+#include <algorithm>
 #include <type_traits>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace xml11 {
 
@@ -27,12 +36,17 @@ using BufferTypePtr = std::shared_ptr<BufferType>;
 using WriterTypePtr = std::shared_ptr<WriterType>;
 using ReaderTypePtr = std::shared_ptr<ReaderType>;
 
-static inline void InitializeParser() noexcept
+// The process-wide parser state is set up once and never torn down, since
+// any other thread may be using libxml2 at any moment. xmlCleanupParser is
+// left to the application, at exit.
+static inline void InitializeParser()
 {
-    xmlInitParser();
+    static std::once_flag once;
+    std::call_once(once, [] { xmlInitParser(); });
 }
 
-static inline void CleanupParser() noexcept
+// Error state is kept per thread by libxml2, so every worker resets its own.
+static inline void ResetErrors() noexcept
 {
     if (xmlGetLastError()) {
         xmlResetError(xmlGetLastError());
@@ -41,7 +55,6 @@ static inline void CleanupParser() noexcept
 
     xmlSetStructuredErrorFunc(NULL, NULL);
     xmlSetGenericErrorFunc(NULL, NULL);
-    xmlCleanupParser();
 }
 
 template<class T, class Fn>
@@ -86,72 +99,124 @@ static inline ReaderType* CreateReader(const std::string& text) noexcept
     return new ReaderType(xmlReaderForMemory(text.data(), text.size(), NULL, NULL, parseOptions));
 }
 
-static inline BufferTypePtr GetXmlBuffer(const bool useCaching) noexcept
+/********************************************************************************
+ * A context keeps its buffer, writer and reader between documents. The one
+ * used for caching belongs to the calling thread, and batches give every
+ * worker its own for the duration of the batch.
+ ********************************************************************************/
+
+struct XmlContext final {
+    BufferTypePtr buffer {nullptr};
+    WriterTypePtr writer {nullptr};
+    ReaderTypePtr reader {nullptr};
+};
+
+static inline XmlContext& CachedXmlContext() noexcept
+{
+    thread_local XmlContext context;
+    return context;
+}
+
+static inline BufferTypePtr GetXmlBuffer(XmlContext& context) noexcept
 {
-    if (useCaching) {
-        static const auto buffer = BufferTypePtr(CreateBuffer(), FreeXmlBuffer);
-        xmlBufferEmpty(*buffer);
-        return buffer;
+    if (context.buffer) {
+        xmlBufferEmpty(*context.buffer);
     }
+    else {
+        context.buffer = BufferTypePtr(CreateBuffer(), FreeXmlBuffer);
+    }
+    return context.buffer;
+}
 
-    return BufferTypePtr(CreateBuffer(), FreeXmlBuffer);
+static inline WriterTypePtr GetXmlWriter(XmlContext& context, const BufferTypePtr& buffer) noexcept
+{
+    if (not context.writer) {
+        context.writer = WriterTypePtr(CreateWriter(buffer), FreeXmlWriter);
+    }
+    return context.writer;
 }
 
-static inline WriterTypePtr GetXmlWriter(const bool useCaching, const BufferTypePtr& buffer) noexcept
+static inline ReaderTypePtr GetXmlReader(XmlContext& context, const std::string& text) noexcept
 {
-    if (useCaching) {
-        static const auto writer = WriterTypePtr(CreateWriter(buffer), FreeXmlWriter);
-        return writer;
+    if (context.reader) { // reuse xml text reader instance
+        xmlReaderNewMemory(*context.reader, text.data(), text.size(), NULL, NULL, parseOptions);
+    }
+    else {
+        context.reader = ReaderTypePtr(CreateReader(text), FreeXmlReader);
+    }
+    return context.reader;
+}
+
+// xmlTextWriterWriteAttribute escapes the value character by character, so
+// clean values are written as they are.
+static inline int WriteAttribute(
+    const xmlTextWriterPtr writer,
+    const std::string& name,
+    const std::string& value)
+{
+    if (NeedsEscaping(value, ATTRIBUTE_SPECIALS)) {
+        return xmlTextWriterWriteAttribute(
+            writer,
+            reinterpret_cast<const xmlChar*>(name.c_str()),
+            reinterpret_cast<const xmlChar*>(value.c_str()));
     }
 
-    return WriterTypePtr(CreateWriter(buffer), FreeXmlWriter);
+    if (xmlTextWriterStartAttribute(writer, reinterpret_cast<const xmlChar*>(name.c_str())) < 0 or
+        xmlTextWriterWriteRaw(writer, reinterpret_cast<const xmlChar*>(value.c_str())) < 0) {
+        return -1;
+    }
+
+    return xmlTextWriterEndAttribute(writer);
 }
 
-static inline ReaderTypePtr GetXmlReader(const bool useCaching, const std::string& text) noexcept
+// Element text is written as it is; CDATA content goes in sections.
+static inline int WriteText(
+    const xmlTextWriterPtr writer,
+    const NodeType type,
+    const std::string_view text)
 {
-    if (useCaching) {
-        static ReaderTypePtr reader = nullptr;
-        if (reader) { // reuse xml text reader instance
-            xmlReaderNewMemory(*reader, text.data(), text.size(), NULL, NULL, parseOptions);
-        }
-        else {
-            reader = ReaderTypePtr(CreateReader(text), FreeXmlReader);
-        }
-        return reader;
+    if (type != NodeType::CDATA) {
+        return xmlTextWriterWriteRawLen(
+            writer, reinterpret_cast<const xmlChar*>(text.data()), static_cast<int>(text.size()));
     }
 
-    return ReaderTypePtr(CreateReader(text), FreeXmlReader);
+    int rc = 0;
+    ForEachCDataSection(text, [writer, &rc](const std::string_view section) {
+        if (rc < 0 or
+            xmlTextWriterStartCDATA(writer) < 0 or
+            xmlTextWriterWriteRawLen(
+                writer, reinterpret_cast<const xmlChar*>(section.data()), static_cast<int>(section.size())) < 0 or
+            xmlTextWriterEndCDATA(writer) < 0) {
+            rc = -1;
+        }
+    });
+    return rc;
 }
 
+template<class Filter>
 static inline int ConvertXmlToText__(
     const std::shared_ptr<NodeImpl>& root,
     const xmlTextWriterPtr writer,
-    const ValueFilter& valueFilter)
+    const Filter& filter)
 {
+    static_assert(IsInPlaceFilter<Filter>::value, "the filter must change a std::string in place");
+
     if (xmlTextWriterStartElement(writer, reinterpret_cast<const xmlChar*>(root->name().c_str())) < 0) {
         return -1;
     }
 
-    for (const auto& node : root->nodes()) {
+    for (const auto& node : root->attributes()) {
         if (not node) {
             continue;
         }
-        if (node->type() == NodeType::ATTRIBUTE or node->type() == NodeType::OPTIONAL_ATTRIBUTE) {
-            if (valueFilter) {
-                if (xmlTextWriterWriteAttribute(
-                        writer,
-                        reinterpret_cast<const xmlChar*>(node->name().c_str()),
-                        reinterpret_cast<const xmlChar*>(GenerateString(node->text(), valueFilter).c_str())) < 0) {
-                    return -1;
-                }
+        if constexpr (IS_NO_FILTER<Filter>) {
+            if (WriteAttribute(writer, node->name(), node->text()) < 0) {
+                return -1;
             }
-            else {
-                if (xmlTextWriterWriteAttribute(
-                        writer,
-                        reinterpret_cast<const xmlChar*>(node->name().c_str()),
-                        reinterpret_cast<const xmlChar*>(node->text().c_str())) < 0) {
-                    return -1;
-                }
+        }
+        else {
+            if (WriteAttribute(writer, node->name(), FilteredCopy(node->text(), filter)) < 0) {
+                return -1;
             }
         }
     }
@@ -160,25 +225,19 @@ static inline int ConvertXmlToText__(
         if (not node) {
             continue;
         }
-        if (node->type() == NodeType::ELEMENT or node->type() == NodeType::OPTIONAL) {
-            if (ConvertXmlToText__(node, writer, valueFilter) < 0) {
-                return -1;
-            }
+        if (ConvertXmlToText__(node, writer, filter) < 0) {
+            return -1;
         }
     }
 
     if (not root->text().empty()) {
-        if (valueFilter) {
-            if (xmlTextWriterWriteRaw(
-                    writer,
-                    reinterpret_cast<const xmlChar*>(GenerateString(root->text(), valueFilter).c_str())) < 0) {
+        if constexpr (IS_NO_FILTER<Filter>) {
+            if (WriteText(writer, root->type(), root->text()) < 0) {
                 return -1;
             }
         }
         else {
-            if (xmlTextWriterWriteRaw(
-                    writer,
-                    reinterpret_cast<const xmlChar*>(root->text().c_str())) < 0) {
+            if (WriteText(writer, root->type(), FilteredCopy(root->text(), filter)) < 0) {
                 return -1;
             }
         }
@@ -250,11 +309,12 @@ static inline void ErrorHandler(void *ctx, const xmlErrorPtr error)
     xmlResetError(error);
 }
 
+template<class Filter>
 static inline std::string ConvertXmlToText_(
     const std::shared_ptr<NodeImpl>& root,
     const bool indent,
-    const ValueFilter& valueFilter,
-    const bool useCaching,
+    const Filter& filter,
+    XmlContext& context,
     std::string& error)
 {
     static auto MEMORY_ALLOCATION_POLICY = XML_BUFFER_ALLOC_DOUBLEIT;
@@ -262,7 +322,7 @@ static inline std::string ConvertXmlToText_(
 
     xmlSetStructuredErrorFunc(&error, reinterpret_cast<xmlStructuredErrorFunc>(ErrorHandler));
 
-    const auto buffer = GetXmlBuffer(useCaching);
+    const auto buffer = GetXmlBuffer(context);
 
     if (not buffer or not *buffer) {
         if (error.empty()) {
@@ -273,7 +333,7 @@ static inline std::string ConvertXmlToText_(
 
     xmlBufferSetAllocationScheme(*buffer, MEMORY_ALLOCATION_POLICY);
 
-    const auto writer = GetXmlWriter(useCaching, buffer);
+    const auto writer = GetXmlWriter(context, buffer);
 
     if (not writer or not *writer) {
         if (error.empty()) {
@@ -292,7 +352,19 @@ static inline std::string ConvertXmlToText_(
     xmlTextWriterSetIndentString(*writer, reinterpret_cast<const xmlChar*>(indent ? "  " : ""));
     xmlTextWriterSetIndent(*writer, indent ? 1 : 0 /*indent*/);
 
-    if ((rc = ConvertXmlToText__(root, *writer, valueFilter)) < 0) {
+    // A lazily parsed part that turns out to be malformed, or a filter, may
+    // throw halfway through; a writer left inside the document is not reused.
+    try {
+        rc = ConvertXmlToText__(root, *writer, filter);
+    }
+    catch (...) {
+        context.writer = nullptr;
+        ResetErrors();
+        throw;
+    }
+
+    if (rc < 0) {
+        context.writer = nullptr;
         if (error.empty()) {
             error = CreateErrorText("ConvertXmlToText__");
         }
@@ -310,20 +382,76 @@ static inline std::string ConvertXmlToText_(
                        xmlBufferLength(*buffer));
 }
 
-static inline NodeImpl& FindLastByDepth(NodeImpl& root, size_t depth)
-{
-    auto* node = &root;
-    for (depth -= 1; depth and not node->nodes().empty() and node->nodes().back(); --depth) {
-        node = &*node->nodes().back();
+/********************************************************************************
+ * Elements that are still open while the reader goes through the document,
+ * indexed by their depth: the root is at zero, and the parent of anything
+ * the reader reports at depth d is the last element seen at depth d - 1.
+ * Every new element cuts off the deeper entries of the elements that have
+ * been closed since, so finding a parent takes constant time.
+ ********************************************************************************/
+
+class OpenElements final {
+public:
+    inline explicit OpenElements(NodeImpl& root)
+        : m_elements {&root}
+    {
     }
-    return *node;
-}
 
+    inline NodeImpl& parent(const int depth) const noexcept
+    {
+        const auto index = depth > 0 ? static_cast<size_t>(depth - 1) : 0;
+        return *m_elements[std::min(index, m_elements.size() - 1)];
+    }
+
+    inline void open(NodeImpl& element, const int depth)
+    {
+        m_elements.resize(std::min(static_cast<size_t>(std::max(depth, 1)), m_elements.size()));
+        m_elements.push_back(&element);
+    }
+
+private:
+    std::vector<NodeImpl*> m_elements {};
+};
+
+/********************************************************************************
+ * The reader keeps names in its own dictionary, so the same name always comes
+ * back as the same pointer during one parse. With the name table, remembering
+ * the atom per pointer avoids going to the table for every element; without
+ * it the name is copied straight into the node.
+ ********************************************************************************/
+
+class NameCache final {
+public:
+#ifdef USE_XML11_NAME_TABLE
+    inline Atom operator() (const xmlChar* name)
+    {
+        const auto it = m_atoms.find(name);
+        if (it != m_atoms.end()) {
+            return it->second;
+        }
+
+        const auto atom = NameTable::global().intern(
+            {reinterpret_cast<const char*>(name), static_cast<size_t>(xmlStrlen(name))});
+        m_atoms.emplace(name, atom);
+        return atom;
+    }
+
+private:
+    std::unordered_map<const xmlChar*, Atom> m_atoms {};
+#else
+    inline std::string_view operator() (const xmlChar* name) const noexcept
+    {
+        return {reinterpret_cast<const char*>(name), static_cast<size_t>(xmlStrlen(name))};
+    }
+#endif
+};
+
+template<class Filter>
 static inline void FetchAllAttributes(
     NodeImpl& node,
     const xmlTextReaderPtr reader,
-    const bool isCaseInsensitive,
-    ValueFilter valueFilter)
+    const Filter& filter,
+    NameCache& names)
 {
     if (xmlTextReaderHasAttributes(reader)) {
         while (xmlTextReaderMoveToNextAttribute(reader)) {
@@ -331,38 +459,43 @@ static inline void FetchAllAttributes(
             const xmlChar* value = xmlTextReaderConstValue(reader);
 
             if (name and value) {
-                if (valueFilter) {
-                    NodeImpl prop {
-                        {reinterpret_cast<const char*>(name), static_cast<size_t>(xmlStrlen(name))},
-                        GenerateString(
-                            std::string(reinterpret_cast<const char*>(value),
-                                        static_cast<size_t>(xmlStrlen(value))),
-                            valueFilter)
-                    };
-                    prop.type(NodeType::ATTRIBUTE);
-                    prop.isCaseInsensitive(isCaseInsensitive);
-                    node.addNode(std::move(prop));
-                }
-                else {
-                    NodeImpl prop {
-                        {reinterpret_cast<const char*>(name), static_cast<size_t>(xmlStrlen(name))},
-                        {reinterpret_cast<const char*>(value), static_cast<size_t>(xmlStrlen(value))},
-                    };
-                    prop.type(NodeType::ATTRIBUTE);
-                    prop.isCaseInsensitive(isCaseInsensitive);
-                    node.addNode(std::move(prop));
-                }
+                std::string text(reinterpret_cast<const char*>(value), static_cast<size_t>(xmlStrlen(value)));
+                filter(text);
+                node.emplaceAttribute(names(name), std::move(text));
             }
         }
         xmlTextReaderMoveToElement(reader);
     }
 }
 
+// Text and CDATA are copied only when the filter has to change them.
+template<class Filter>
+static inline void AppendContent(NodeImpl& node, const int nodeType, const xmlChar* const value, const Filter& filter)
+{
+    std::string_view content {reinterpret_cast<const char*>(value), static_cast<size_t>(xmlStrlen(value))};
+
+    std::string filtered;
+    if constexpr (not IS_NO_FILTER<Filter>) {
+        filtered = content;
+        filter(filtered);
+        content = filtered;
+    }
+
+    if (nodeType == XML_CDATA_SECTION_NODE) {
+        node.appendCData(content);
+    }
+    else {
+        node.appendText(content);
+    }
+}
+
+template<class Filter>
 static inline std::shared_ptr<NodeImpl> ParseXmlFromText__(
     const xmlTextReaderPtr reader,
-    const bool isCaseInsensitive,
-    const ValueFilter& valueFilter)
+    const Filter& filter)
 {
+    static_assert(IsInPlaceFilter<Filter>::value, "the filter must change a std::string in place");
+
     auto ret = xmlTextReaderRead(reader);
     auto nodeType = xmlTextReaderNodeType(reader);
 
@@ -376,11 +509,13 @@ static inline std::shared_ptr<NodeImpl> ParseXmlFromText__(
         return nullptr;
     }
 
-    const auto root = std::make_shared<NodeImpl>(
-        std::string{reinterpret_cast<const char*>(rootName), static_cast<size_t>(xmlStrlen(rootName))});
-    root->isCaseInsensitive(isCaseInsensitive);
+    NameCache names;
 
-    FetchAllAttributes(*root, reader, isCaseInsensitive, valueFilter);
+    const auto root = std::make_shared<NodeImpl>(names(rootName));
+
+    FetchAllAttributes(*root, reader, filter, names);
+
+    OpenElements elements {*root};
 
     for (ret = xmlTextReaderRead(reader); ret == 1; ret = xmlTextReaderRead(reader)) {
         nodeType = xmlTextReaderNodeType(reader);
@@ -389,50 +524,20 @@ static inline std::shared_ptr<NodeImpl> ParseXmlFromText__(
             const xmlChar* name = xmlTextReaderConstName(reader);
 
             if (name) {
-                NodeImpl node {
-                    {reinterpret_cast<const char*>(name), static_cast<size_t>(xmlStrlen(name))},
-                };
-                node.type(NodeType::ELEMENT);
-                node.isCaseInsensitive(isCaseInsensitive);
+                const auto depth = xmlTextReaderDepth(reader);
 
-                FetchAllAttributes(node, reader, isCaseInsensitive, valueFilter);
+                auto& element = elements.parent(depth).emplaceChild(names(name));
 
-                auto& lastNode = FindLastByDepth(*root, xmlTextReaderDepth(reader));
-                lastNode.addNode(std::move(node));
-            }
-        }
-        else if (nodeType == XML_TEXT_NODE and xmlTextReaderHasValue(reader)) {
-            const xmlChar* value = xmlTextReaderConstValue(reader);
+                FetchAllAttributes(element, reader, filter, names);
 
-            if (value) {
-                auto& lastNode = FindLastByDepth(*root, xmlTextReaderDepth(reader));
-                if (valueFilter) {
-                    lastNode.text().append(GenerateString(
-                                               std::string(reinterpret_cast<const char*>(value),
-                                                           static_cast<size_t>(xmlStrlen(value))),
-                                               valueFilter));
-                }
-                else {
-                    lastNode.text().append(reinterpret_cast<const char*>(value), xmlStrlen(value));
-                }
+                elements.open(element, depth);
             }
         }
-        else if (nodeType == XML_CDATA_SECTION_NODE and xmlTextReaderHasValue(reader)) {
+        else if ((nodeType == XML_TEXT_NODE or nodeType == XML_CDATA_SECTION_NODE) and xmlTextReaderHasValue(reader)) {
             const xmlChar* value = xmlTextReaderConstValue(reader);
 
             if (value) {
-                auto& lastNode = FindLastByDepth(*root, xmlTextReaderDepth(reader));
-                lastNode.text() += "<![CDATA[";
-                if (valueFilter) {
-                    lastNode.text().append(GenerateString(
-                        std::string(reinterpret_cast<const char*>(value),
-                                    static_cast<size_t>(xmlStrlen(value))),
-                        valueFilter));
-                }
-                else {
-                    lastNode.text().append(reinterpret_cast<const char*>(value), xmlStrlen(value));
-                }
-                lastNode.text() += "]]>";
+                AppendContent(elements.parent(xmlTextReaderDepth(reader)), nodeType, value, filter);
             }
         }
     }
@@ -440,11 +545,11 @@ static inline std::shared_ptr<NodeImpl> ParseXmlFromText__(
     return ret != 0 ? nullptr : root;
 }
 
+template<class Filter>
 static inline std::shared_ptr<NodeImpl> ParseXmlFromText_(
     const std::string& text,
-    const bool isCaseInsensitive,
-    const ValueFilter& valueFilter,
-    const bool useCaching,
+    const Filter& filter,
+    XmlContext& context,
     std::string& error)
 {
     if (text.empty()) {
@@ -453,7 +558,7 @@ static inline std::shared_ptr<NodeImpl> ParseXmlFromText_(
 
     xmlSetStructuredErrorFunc(&error, reinterpret_cast<xmlStructuredErrorFunc>(ErrorHandler));
 
-    const auto reader = GetXmlReader(useCaching, text);
+    const auto reader = GetXmlReader(context, text);
 
     if (not reader or not *reader) {
         if (error.empty()) {
@@ -462,7 +567,7 @@ static inline std::shared_ptr<NodeImpl> ParseXmlFromText_(
         return nullptr;
     }
 
-    const auto node = ParseXmlFromText__(*reader, isCaseInsensitive, valueFilter);
+    const auto node = ParseXmlFromText__(*reader, filter);
 
     if (not node and error.empty()) {
         error = CreateErrorText("ParseXmlFromText__");
@@ -471,44 +576,228 @@ static inline std::shared_ptr<NodeImpl> ParseXmlFromText_(
     return node;
 }
 
+// Without caching the context lives only for this call, so it is released
+// before the parser is cleaned up.
+template<class Filter>
+static inline std::string ConvertXmlToText_(
+    const std::shared_ptr<NodeImpl>& root,
+    const bool indent,
+    const Filter& filter,
+    const bool useCaching,
+    std::string& error)
+{
+    XmlContext context;
+    return ConvertXmlToText_(root, indent, filter, useCaching ? CachedXmlContext() : context, error);
+}
+
+template<class Filter>
+static inline std::shared_ptr<NodeImpl> ParseXmlFromText_(
+    const std::string& text,
+    const Filter& filter,
+    const bool useCaching,
+    std::string& error)
+{
+    XmlContext context;
+    return ParseXmlFromText_(text, filter, useCaching ? CachedXmlContext() : context, error);
+}
+
 } /* anonymous namespace */
 
+template<class Filter>
 inline std::string ConvertXmlToText(
     const std::shared_ptr<NodeImpl>& root,
     const bool indent,
-    const ValueFilter& valueFilter,
+    const Filter& filter,
     const bool useCaching)
 {
-    std::string error;
+    return ObserveSerialize(Backend::LIBXML2, root, [&] {
+        std::string error;
 
-    InitializeParser();
-    const auto result = ConvertXmlToText_(root, indent, valueFilter, useCaching, error);
-    CleanupParser();
+        InitializeParser();
+        auto result = ConvertXmlToText_(root, indent, filter, useCaching, error);
+        ResetErrors();
 
-    if (not error.empty()) {
-        throw Xml11Exception{error};
-    }
+        if (not error.empty()) {
+            throw Xml11Exception{error};
+        }
+
+        return result;
+    });
+}
+
+template<class Filter>
+inline std::shared_ptr<NodeImpl> ParseXmlFromText(
+    const std::string& text,
+    const Filter& filter,
+    const bool useCaching)
+{
+    return ObserveParse(Backend::LIBXML2, text, [&] {
+        std::string error;
+
+        InitializeParser();
+        auto result = ParseXmlFromText_(text, filter, useCaching, error);
+        ResetErrors();
 
-    return result;
+        if (not error.empty()) {
+            throw Xml11Exception{error};
+        }
+
+        return result;
+    });
+}
+
+inline std::string ConvertXmlToText(
+    const std::shared_ptr<NodeImpl>& root,
+    const bool indent,
+    const ValueFilter& valueFilter,
+    const bool useCaching)
+{
+    return WithFilter(valueFilter, [&](const auto& filter) {
+        return ConvertXmlToText(root, indent, filter, useCaching);
+    });
 }
 
 inline std::shared_ptr<NodeImpl> ParseXmlFromText(
     const std::string& text,
-    const bool isCaseInsensitive,
     const ValueFilter& valueFilter,
     const bool useCaching)
 {
-    std::string error;
+    return WithFilter(valueFilter, [&](const auto& filter) {
+        return ParseXmlFromText(text, filter, useCaching);
+    });
+}
 
-    InitializeParser();
-    const auto result = ParseXmlFromText_(text, isCaseInsensitive, valueFilter, useCaching, error);
-    CleanupParser();
+inline std::shared_ptr<NodeImpl> ParseXmlFromTextInParallel(
+    const std::string& text,
+    const ValueFilter& valueFilter,
+    const size_t threads)
+{
+    return ObserveParse(Backend::LIBXML2, text, [&] {
+        InitializeParser();
+
+        return ParseInParallel(text, threads, [&valueFilter](const std::string& part) {
+            std::string error;
+            auto node = WithFilter(valueFilter, [&](const auto& filter) {
+                return ParseXmlFromText_(part, filter, false, error);
+            });
+            ResetErrors();
+
+            if (not error.empty()) {
+                throw Xml11Exception{error};
+            }
+
+            return node;
+        });
+    });
+}
+
+inline std::shared_ptr<NodeImpl> ParseXmlFromTextLazily(const std::string& text)
+{
+    return ObserveParse(Backend::LIBXML2, text, [&] {
+        InitializeParser();
+
+        return ParseXmlLazily(text);
+    });
+}
+
+// A part of a lazily parsed document. The parser was set up when the root
+// was parsed, and the part is often read in the middle of another call of
+// this thread, such as a serialization, so the thread's own reader is used
+// and that call's error handler is put back afterwards.
+inline std::shared_ptr<NodeImpl> ParseXmlPart(const std::string& text)
+{
+    const auto handler = xmlStructuredError;
+    void* const handlerContext = xmlStructuredErrorContext;
+
+    std::string error;
+    auto node = ParseXmlFromText_(text, NoFilter {}, CachedXmlContext(), error);
+    ResetErrors();
+    xmlSetStructuredErrorFunc(handlerContext, handler);
 
     if (not error.empty()) {
         throw Xml11Exception{error};
     }
 
-    return result;
+    return node;
+}
+
+inline std::string ConvertXmlToTextInParallel(
+    const std::shared_ptr<NodeImpl>& root,
+    const bool indent,
+    const ValueFilter& valueFilter,
+    const size_t threads)
+{
+    return ObserveSerialize(Backend::LIBXML2, root, [&] {
+        InitializeParser();
+
+        return SerializeInParallel(root, threads, [indent, &valueFilter](const std::shared_ptr<NodeImpl>& part) {
+            std::string error;
+            auto text = WithFilter(valueFilter, [&](const auto& filter) {
+                return ConvertXmlToText_(part, indent, filter, false, error);
+            });
+            ResetErrors();
+
+            if (not error.empty()) {
+                throw Xml11Exception{error};
+            }
+
+            return text;
+        });
+    });
+}
+
+/********************************************************************************
+ * Every worker of a batch reuses its own reader or writer for all the
+ * documents it takes.
+ ********************************************************************************/
+
+inline std::vector<std::shared_ptr<NodeImpl>> ParseXmlFromTextBatch(
+    const std::vector<std::string>& texts,
+    const ValueFilter& valueFilter,
+    const size_t threads)
+{
+    InitializeParser();
+
+    return RunBatch<std::shared_ptr<NodeImpl>, XmlContext>(texts, threads, [&valueFilter](XmlContext& context, const std::string& text) {
+        return ObserveParse(Backend::LIBXML2, text, [&] {
+            std::string error;
+            auto node = WithFilter(valueFilter, [&](const auto& filter) {
+                return ParseXmlFromText_(text, filter, context, error);
+            });
+            ResetErrors();
+
+            if (not error.empty()) {
+                throw Xml11Exception{error};
+            }
+
+            return node;
+        });
+    });
+}
+
+inline std::vector<std::string> ConvertXmlToTextBatch(
+    const std::vector<std::shared_ptr<NodeImpl>>& roots,
+    const bool indent,
+    const ValueFilter& valueFilter,
+    const size_t threads)
+{
+    InitializeParser();
+
+    return RunBatch<std::string, XmlContext>(roots, threads, [indent, &valueFilter](XmlContext& context, const std::shared_ptr<NodeImpl>& root) {
+        return ObserveSerialize(Backend::LIBXML2, root, [&] {
+            std::string error;
+            auto text = WithFilter(valueFilter, [&](const auto& filter) {
+                return ConvertXmlToText_(root, indent, filter, context, error);
+            });
+            ResetErrors();
+
+            if (not error.empty()) {
+                throw Xml11Exception{error};
+            }
+
+            return text;
+        });
+    });
 }
 
 } /* namespace xml11 */
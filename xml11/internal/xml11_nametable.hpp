@@ -0,0 +1,243 @@
+#pragma once
+
+#include "xml11_utils.hpp"
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace xml11 {
+
+/********************************************************************************
+ * Interned element and attribute names.
+ *
+ * By default every node keeps its name in a string of its own, which holds
+ * the short names of most vocabularies without allocating, and lookups
+ * compare the strings.
+ *
+ * With USE_XML11_NAME_TABLE defined, every name is stored once per process
+ * and nodes keep a pointer to it, so equal names are equal pointers. Each
+ * entry also points to the entry of its lower-cased spelling, which turns
+ * case-insensitive matching into a pointer compare as well. Entries are
+ * never released, so the table grows by the number of distinct names ever
+ * seen: enable it only for a known vocabulary, not for untrusted input.
+ * Names are shared then, so Node::name() returns a const reference.
+ ********************************************************************************/
+
+#ifdef USE_XML11_NAME_TABLE
+
+class NameTable final {
+public:
+    struct Entry final {
+        std::string name {};
+        const Entry* folded {nullptr};
+    };
+
+    using Atom = const Entry*;
+
+public:
+    NameTable(const NameTable&) = delete;
+    NameTable& operator = (const NameTable&) = delete;
+
+    static inline NameTable& global() noexcept
+    {
+        static NameTable table;
+        return table;
+    }
+
+    /********************************************************************************
+     * Main functions.
+     ********************************************************************************/
+
+    inline Atom intern(const std::string_view name)
+    {
+        if (const auto atom = find(name)) {
+            return atom;
+        }
+
+        const auto lowerName = to_lower_copy(std::string(name));
+
+        std::unique_lock<std::shared_mutex> lock {m_mutex};
+
+        const auto folded = insert(lowerName, nullptr);
+        return lowerName == name ? folded : insert(name, folded);
+    }
+
+    inline Atom find(const std::string_view name) const noexcept
+    {
+        std::shared_lock<std::shared_mutex> lock {m_mutex};
+
+        const auto it = m_entries.find(name);
+        return it == m_entries.end() ? nullptr : it->second.get();
+    }
+
+    // Folds into a buffer of the calling thread, so a lookup allocates only
+    // the first time a name that long is seen.
+    inline Atom findFolded(const std::string_view name) const
+    {
+        thread_local std::string folded;
+        folded.assign(name);
+        to_lower_inplace(folded);
+        return find(folded);
+    }
+
+    /********************************************************************************
+     * Misc functions.
+     ********************************************************************************/
+
+    inline Atom empty() const noexcept
+    {
+        return m_empty;
+    }
+
+    inline size_t size() const noexcept
+    {
+        std::shared_lock<std::shared_mutex> lock {m_mutex};
+        return m_entries.size();
+    }
+
+private:
+    inline NameTable()
+    {
+        std::unique_lock<std::shared_mutex> lock {m_mutex};
+        m_empty = insert({}, nullptr);
+    }
+
+    inline Atom insert(const std::string_view name, const Entry* folded)
+    {
+        const auto it = m_entries.find(name);
+        if (it != m_entries.end()) {
+            return it->second.get();
+        }
+
+        auto entry = std::make_unique<Entry>();
+        entry->name = std::string(name);
+        entry->folded = folded ? folded : entry.get();
+
+        const std::string_view key {entry->name};
+        return m_entries.emplace(key, std::move(entry)).first->second.get();
+    }
+
+private:
+    mutable std::shared_mutex m_mutex {};
+    std::unordered_map<std::string_view, std::unique_ptr<Entry>> m_entries {};
+    Atom m_empty {nullptr};
+};
+
+using Atom = NameTable::Atom;
+using NodeName = Atom;
+
+static inline NodeName MakeNodeName(const std::string_view name)
+{
+    return NameTable::global().intern(name);
+}
+
+static inline NodeName EmptyNodeName() noexcept
+{
+    return NameTable::global().empty();
+}
+
+static inline const std::string& NameText(const NodeName name) noexcept
+{
+    return name->name;
+}
+
+/********************************************************************************
+ * Name matching policies. Lookups are instantiated for one of them, so the
+ * loop over children compares names without asking which mode is active.
+ * A key that is not in the table matches nothing.
+ ********************************************************************************/
+
+struct CaseSensitive final {
+    static inline Atom key(const std::string& name) noexcept
+    {
+        return NameTable::global().find(name);
+    }
+
+    static inline bool isKnown(const Atom key) noexcept
+    {
+        return key;
+    }
+
+    static inline bool matches(const NodeName name, const Atom key) noexcept
+    {
+        return name == key;
+    }
+};
+
+struct CaseInsensitive final {
+    static inline Atom key(const std::string& name)
+    {
+        return NameTable::global().findFolded(name);
+    }
+
+    static inline bool isKnown(const Atom key) noexcept
+    {
+        return key;
+    }
+
+    static inline bool matches(const NodeName name, const Atom key) noexcept
+    {
+        return name->folded == key;
+    }
+};
+
+#else
+
+using NodeName = std::string;
+
+static inline NodeName MakeNodeName(const std::string_view name)
+{
+    return std::string {name};
+}
+
+static inline NodeName EmptyNodeName() noexcept
+{
+    return {};
+}
+
+static inline const std::string& NameText(const NodeName& name) noexcept
+{
+    return name;
+}
+
+struct CaseSensitive final {
+    static inline std::string_view key(const std::string& name) noexcept
+    {
+        return name;
+    }
+
+    static inline bool isKnown(const std::string_view) noexcept
+    {
+        return true;
+    }
+
+    static inline bool matches(const NodeName& name, const std::string_view key) noexcept
+    {
+        return name == key;
+    }
+};
+
+struct CaseInsensitive final {
+    static inline std::string_view key(const std::string& name) noexcept
+    {
+        return name;
+    }
+
+    static inline bool isKnown(const std::string_view) noexcept
+    {
+        return true;
+    }
+
+    static inline bool matches(const NodeName& name, const std::string_view key) noexcept
+    {
+        return EqualsFolded(name, key);
+    }
+};
+
+#endif // USE_XML11_NAME_TABLE
+
+} // namespace xml11
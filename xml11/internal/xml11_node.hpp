@@ -4,7 +4,15 @@
 #include "xml11_exceptions.hpp"
 #include "xml11_utils.hpp"
 #include "xml11_nodeimpl.hpp"
+#include "xml11_stats.hpp"
+#include "xml11_slices.hpp"
+#include "xml11_filters.hpp"
+#include "xml11_encoding.hpp"
+#include "xml11_values.hpp"
+#include "xml11_lazy.hpp"
+#include "xml11_tape.hpp"
 #include <type_traits>
+#include <unordered_map>
 
 namespace xml11 {
 
@@ -21,7 +29,72 @@ public:
         const ValueFilter valueFilter_ = nullptr,
         const bool useCaching = false)
     {
-        return {ParseXmlFromText(text, isCaseInsensitive, valueFilter_, useCaching)};
+        const StatsScope scope {Operation::PARSE};
+
+        return {ParseXmlFromText(text, valueFilter_, useCaching), isCaseInsensitive};
+    }
+
+    /********************************************************************************
+     * The same with an in-place filter: any object callable as
+     * void(std::string&), such as Trim or chain(Trim {}, RemoveControlChars {}).
+     * It is inlined into the parser and changes each value before it is stored.
+     ********************************************************************************/
+
+    template<class Filter, class = EnableIfInPlaceFilter<Filter>>
+    static inline Node fromString(
+        const std::string& text,
+        const bool isCaseInsensitive,
+        const Filter& filter,
+        const bool useCaching = false)
+    {
+        const StatsScope scope {Operation::PARSE};
+
+        return {ParseXmlFromText(text, filter, useCaching), isCaseInsensitive};
+    }
+
+    /********************************************************************************
+     * Builds the children of the root only when they are first descended
+     * into, for handlers that read a few parts of a large document. Errors
+     * in a child are thrown by the first access to it.
+     ********************************************************************************/
+
+    static inline Node fromStringLazily(
+        const std::string& text,
+        const bool isCaseInsensitive = true)
+    {
+        const StatsScope scope {Operation::PARSE};
+
+        return {ParseXmlFromTextLazily(text), isCaseInsensitive};
+    }
+
+    /********************************************************************************
+     * Parses a document in a legacy encoding: the text is converted to UTF-8
+     * in one pass first, so the values need no filter of their own.
+     ********************************************************************************/
+
+    static inline Node fromString(
+        const std::string& text,
+        const Encoding encoding,
+        const bool isCaseInsensitive = true)
+    {
+        return fromString(ToUtf8(text, encoding), isCaseInsensitive);
+    }
+
+    /********************************************************************************
+     * Splits a large document by the children of its root and parses them on
+     * several threads (all hardware threads when zero). The result is the
+     * same tree fromString would build.
+     ********************************************************************************/
+
+    static inline Node fromStringInParallel(
+        const std::string& text,
+        const bool isCaseInsensitive = true,
+        const ValueFilter valueFilter_ = nullptr,
+        const size_t threads = 0)
+    {
+        const StatsScope scope {Operation::PARSE};
+
+        return {ParseXmlFromTextInParallel(text, valueFilter_, threads), isCaseInsensitive};
     }
 
     inline std::string toString(
@@ -29,12 +102,85 @@ public:
         const ValueFilter valueFilter = nullptr,
         const bool useCaching = false) const
     {
+        const StatsScope scope {Operation::SERIALIZE};
+
         if (not pimpl) {
             throw Xml11Exception("Error! Node is not valid! [toString]");
         }
         return ConvertXmlToText(pimpl, indent, valueFilter, useCaching);
     }
 
+    template<class Filter, class = EnableIfInPlaceFilter<Filter>>
+    inline std::string toString(
+        const bool indent,
+        const Filter& filter,
+        const bool useCaching = false) const
+    {
+        const StatsScope scope {Operation::SERIALIZE};
+
+        if (not pimpl) {
+            throw Xml11Exception("Error! Node is not valid! [toString]");
+        }
+        return ConvertXmlToText(pimpl, indent, filter, useCaching);
+    }
+
+    // Writes the document in a legacy encoding, converted in one pass.
+    inline std::string toString(
+        const Encoding encoding,
+        const bool indent = true) const
+    {
+        return FromUtf8(toString(indent), encoding);
+    }
+
+    /********************************************************************************
+     * Renders runs of the children of a wide root on several threads (all
+     * hardware threads when zero) and joins them in order. The result is the
+     * same text toString would produce.
+     ********************************************************************************/
+
+    inline std::string toStringInParallel(
+        const bool indent = true,
+        const ValueFilter valueFilter = nullptr,
+        const size_t threads = 0) const
+    {
+        const StatsScope scope {Operation::SERIALIZE};
+
+        if (not pimpl) {
+            throw Xml11Exception("Error! Node is not valid! [toStringInParallel]");
+        }
+        return ConvertXmlToTextInParallel(pimpl, indent, valueFilter, threads);
+    }
+
+    /********************************************************************************
+     * Describes the same text as toString with a list of slices for writev,
+     * without copying names and texts out of the tree.
+     ********************************************************************************/
+
+    inline TextSlices toSlices(
+        const bool indent = true,
+        const ValueFilter valueFilter = nullptr) const
+    {
+        const StatsScope scope {Operation::SERIALIZE};
+
+        if (not pimpl) {
+            throw Xml11Exception("Error! Node is not valid! [toSlices]");
+        }
+        return ConvertXmlToSlices(pimpl, indent, valueFilter);
+    }
+
+    template<class Filter, class = EnableIfInPlaceFilter<Filter>>
+    inline TextSlices toSlices(
+        const bool indent,
+        const Filter& filter) const
+    {
+        const StatsScope scope {Operation::SERIALIZE};
+
+        if (not pimpl) {
+            throw Xml11Exception("Error! Node is not valid! [toSlices]");
+        }
+        return ConvertXmlToSlices(pimpl, indent, filter);
+    }
+
 public:
     static inline void AddNode(Node&) noexcept
     {
@@ -66,7 +212,7 @@ public:
     >
     static inline void AddNode(Node& node, T&& value)
     {
-        node.text(std::to_string(std::forward<T>(value)));
+        FormatValue(node.text(), value);
     }
 
     template<std::size_t N>
@@ -140,29 +286,39 @@ public:
     {
     }
 
-    inline Node(const std::shared_ptr<class NodeImpl>& node) noexcept
-        : pimpl {node}
+    // The matching mode is not kept by the node itself, so a handle to one
+    // is always told the mode of its document.
+    inline Node(const std::shared_ptr<class NodeImpl>& node, const bool isCaseInsensitive) noexcept
+        : pimpl {node},
+          m_isCaseInsensitive {isCaseInsensitive}
     {
+        CountRefcount();
     }
 
-    inline Node(std::shared_ptr<class NodeImpl>&& node) noexcept
-        : pimpl {std::move(node)}
+    inline Node(std::shared_ptr<class NodeImpl>&& node, const bool isCaseInsensitive) noexcept
+        : pimpl {std::move(node)},
+          m_isCaseInsensitive {isCaseInsensitive}
     {
     }
 
     inline Node(const Node& node) noexcept
-        : pimpl {node.pimpl}
+        : pimpl {node.pimpl},
+          m_isCaseInsensitive {node.m_isCaseInsensitive}
     {
+        CountRefcount();
     }
 
     inline Node(Node&& node) noexcept
-        : pimpl {std::move(node.pimpl)}
+        : pimpl {std::move(node.pimpl)},
+          m_isCaseInsensitive {node.m_isCaseInsensitive}
     {
         node.pimpl = nullptr;
     }
 
     inline Node(std::string name)
     {
+        const StatsScope scope {Operation::BUILD};
+
         if (not name.empty()) {
             pimpl = std::make_shared<NodeImpl>(std::move(name));
         }
@@ -182,6 +338,8 @@ public:
 
     inline Node(std::string name, std::string value)
     {
+        const StatsScope scope {Operation::BUILD};
+
         if (not (name.empty() and value.empty())) {
             pimpl = std::make_shared<NodeImpl>(std::move(name), std::move(value));
         }
@@ -192,6 +350,8 @@ public:
 
     inline Node(std::string name, std::string value, const NodeType type)
     {
+        const StatsScope scope {Operation::BUILD};
+
         if ((type == NodeType::OPTIONAL or type == NodeType::OPTIONAL_ATTRIBUTE) and value.empty()) {
             return;
         }
@@ -313,7 +473,7 @@ public:
     {
         if (!!(*this)) {
             if (param) {
-                this->value(std::to_string(*std::forward<T>(param)));
+                FormatValue(this->text(), *std::forward<T>(param));
                 if ((type == NodeType::OPTIONAL or type == NodeType::OPTIONAL_ATTRIBUTE) and
                     this->text().empty() and this->nodes().empty()) {
                     pimpl = nullptr;
@@ -343,20 +503,20 @@ public:
     template<
         class T,
         class ... Ts,
-        class = LikeAIntegralWithoutOptions<T, Ts...>
+        class = LikeANumberWithoutOptions<T, Ts...>
     >
     inline Node(std::string name, T&& value)
-        : Node(std::move(name), std::to_string(std::forward<T>(value)))
+        : Node(std::move(name), FormatValue(value))
     {
     }
 
     template<
         class T,
         class ... Ts,
-        class = LikeAIntegralWithOptions<T, Ts...>
+        class = LikeANumberWithOptions<T, Ts...>
     >
     inline Node(std::string name, T&& value, Ts&& ... args)
-        : Node(std::move(name), std::to_string(std::forward<T>(value)))
+        : Node(std::move(name), FormatValue(value))
     {
         AddNode(*const_cast<Node*>(this), std::forward<Ts>(args)...);
     }
@@ -370,7 +530,7 @@ public:
         : Node(std::move(name))
     {
         if (value) {
-            this->value(std::to_string(*value));
+            FormatValue(this->text(), *value);
         }
         else {
             this->value(std::string());
@@ -400,13 +560,15 @@ public:
     >
     Node& addNode(std::string name, T&& value)
     {
-        return addNode(std::move(name), std::to_string(std::forward<T>(value)));
+        return addNode(std::move(name), FormatValue(value));
     }
 
     inline Node& operator = (const Node& node) noexcept
     {
         if (this != &node) {
+            CountRefcount();
             pimpl = node.pimpl;
+            m_isCaseInsensitive = node.m_isCaseInsensitive;
         }
         return *this;
     }
@@ -415,22 +577,23 @@ public:
     {
         if (this != &node) {
             pimpl = std::move(node.pimpl);
+            m_isCaseInsensitive = node.m_isCaseInsensitive;
             node.pimpl = nullptr;
         }
         return *this;
     }
 
-    inline bool operator == (const Node& node) const noexcept
+    inline bool operator == (const Node& node) const
     {
         return pimpl and node.pimpl and *pimpl == *node.pimpl;
     }
 
-    inline bool operator != (const Node& node) const noexcept
+    inline bool operator != (const Node& node) const
     {
         return not (*this == node);
     }
 
-    inline operator bool() const noexcept
+    inline operator bool() const
     {
         return !!pimpl and *pimpl != NodeImpl {};
     }
@@ -467,10 +630,15 @@ public:
 
     inline NodeList findNodes(const std::string& name)
     {
+        const StatsScope scope {Operation::FIND};
+
         NodeList result;
         if (pimpl) {
-            for (const auto& node : pimpl->findNodes(name)) {
-                result.emplace_back(node);
+            const auto nodes = m_isCaseInsensitive
+                ? pimpl->findNodes<CaseInsensitive>(name)
+                : pimpl->findNodes<CaseSensitive>(name);
+            for (const auto& node : nodes) {
+                result.emplace_back(node, m_isCaseInsensitive);
             }
         }
 
@@ -479,11 +647,18 @@ public:
 
     inline NodeList findNodes(const NodeType& type)
     {
+        const StatsScope scope {Operation::FIND};
+
         NodeList result;
         if (pimpl) {
+            for (const auto& node : pimpl->attributes()) {
+                if (node->isOfType(type)) {
+                    result.emplace_back(node, m_isCaseInsensitive);
+                }
+            }
             for (const auto& node : pimpl->nodes()) {
-                if (node->type() == type) {
-                    result.emplace_back(node);
+                if (node->isOfType(type)) {
+                    result.emplace_back(node, m_isCaseInsensitive);
                 }
             }
         }
@@ -522,20 +697,27 @@ public:
 
     inline Node findNode(const std::string& name)
     {
+        const StatsScope scope {Operation::FIND};
+
         if (not pimpl) {
-            return Node {std::make_shared<NodeImpl>()};
+            return Node {std::make_shared<NodeImpl>(), m_isCaseInsensitive};
         }
-        return pimpl->findNode(name);
+        return {
+            m_isCaseInsensitive ? pimpl->findNode<CaseInsensitive>(name) : pimpl->findNode<CaseSensitive>(name),
+            m_isCaseInsensitive
+        };
     }
 
     inline Node findNode(const NodeType& type)
     {
+        const StatsScope scope {Operation::FIND};
+
         for (const auto& node : nodes()) {
-            if (node.type() == type) {
+            if (node.pimpl->isOfType(type)) {
                 return node;
             }
         }
-        return Node {std::make_shared<NodeImpl>()};
+        return Node {std::make_shared<NodeImpl>(), m_isCaseInsensitive};
     }
 
     inline const Node findNode(const std::string& name) const
@@ -550,6 +732,8 @@ public:
 
     inline NodeList findNodesXPath(const std::string& name)
     {
+        const StatsScope scope {Operation::FIND};
+
         const auto parts = split(name, '/');
         if (parts.size() > 1) {
             Node node = *this;
@@ -573,11 +757,13 @@ public:
 
     inline Node findNodeXPath(const std::string& name)
     {
+        const StatsScope scope {Operation::FIND};
+
         Node node = *this;
         for (const auto& part : split(name, '/')) {
             node = node.findNode(part);
             if (not node) {
-                return Node {std::make_shared<NodeImpl>()};
+                return Node {std::make_shared<NodeImpl>(), m_isCaseInsensitive};
             }
         }
         return node;
@@ -593,7 +779,7 @@ public:
         if (not pimpl) {
             throw Xml11Exception("Error! Node is not valid! [type]");
         }
-        return pimpl->type();
+        return static_cast<const NodeImpl&>(*pimpl).type();
     }
 
     inline void type(const NodeType type)
@@ -604,7 +790,21 @@ public:
         pimpl->type(type);
     }
 
+    inline bool isElement() const
+    {
+        if (not pimpl) {
+            throw Xml11Exception("Error! Node is not valid! [isElement]");
+        }
+        return pimpl->isElement();
+    }
+
+    // The names are shared with USE_XML11_NAME_TABLE, so they can only be
+    // changed by name(std::string) then.
+#ifdef USE_XML11_NAME_TABLE
+    inline const std::string& name() const
+#else
     inline std::string& name() const
+#endif
     {
         if (not pimpl) {
             throw Xml11Exception("Error! Node is not valid! [name]");
@@ -636,15 +836,36 @@ public:
         pimpl->text(std::move(value));
     }
 
+    /********************************************************************************
+     * Reads the text as an integer, a floating point number or a bool without
+     * copying it. Whitespace around the value is ignored; anything else makes
+     * tryAs return nothing and as throw.
+     ********************************************************************************/
+
+    template<class T, class = std::enable_if_t<IsValueType<T>::value>>
+    inline std::optional<T> tryAs() const
+    {
+        if (not pimpl) {
+            throw Xml11Exception("Error! Node is not valid! [tryAs]");
+        }
+        return ParseValue<T>(pimpl->text());
+    }
+
+    template<class T, class = std::enable_if_t<IsValueType<T>::value>>
+    inline T as() const
+    {
+        if (const auto value = tryAs<T>()) {
+            return *value;
+        }
+        throw Xml11Exception("Error! The text of the node '" + name() + "' is not a valid value! [as]");
+    }
+
     inline void value(std::string text)
     {
         if (not pimpl) {
             throw Xml11Exception("Error! Node is not valid! [value]");
         }
-        const auto nodes = pimpl->nodes();
-        for (const auto& node : nodes) {
-            pimpl->eraseNode(node);
-        }
+        pimpl->clearNodes();
 
         if (not text.empty()) {
             try {
@@ -661,15 +882,24 @@ public:
         }
     }
 
-    inline void value(const Node& root)
+    // Numbers and bools are formatted with std::to_chars.
+
+    template<class T, class = std::enable_if_t<IsValueType<T>::value>>
+    inline void value(const T value)
     {
         if (not pimpl) {
             throw Xml11Exception("Error! Node is not valid! [value]");
         }
-        const auto nodes = pimpl->nodes();
-        for (const auto& node : nodes) {
-            pimpl->eraseNode(node);
+        pimpl->clearNodes();
+        FormatValue(pimpl->text(), value);
+    }
+
+    inline void value(const Node& root)
+    {
+        if (not pimpl) {
+            throw Xml11Exception("Error! Node is not valid! [value]");
         }
+        pimpl->clearNodes();
 
         addNode(root);
     }
@@ -679,10 +909,7 @@ public:
         if (not pimpl) {
             throw Xml11Exception("Error! Node is not valid! [value]");
         }
-        const auto nodes = pimpl->nodes();
-        for (const auto& node : nodes) {
-            pimpl->eraseNode(node);
-        }
+        pimpl->clearNodes();
 
         addNode(std::move(root));
         root.pimpl = nullptr;
@@ -723,6 +950,8 @@ public:
 
     inline Node& addNode(const Node& node)
     {
+        const StatsScope scope {Operation::BUILD};
+
         if (node) {
             if (not pimpl) {
                 throw Xml11Exception("Error! Node is not valid! [addNode]");
@@ -735,11 +964,13 @@ public:
 
     inline Node& addNode(Node&& node)
     {
+        const StatsScope scope {Operation::BUILD};
+
         if (node) {
             if (not pimpl) {
                 throw Xml11Exception("Error! Node is not valid! [addNode]");
             }
-            pimpl->addNode(node.pimpl);
+            pimpl->addNode(std::move(node.pimpl));
             node.pimpl = nullptr;
         }
 
@@ -748,11 +979,13 @@ public:
 
     inline Node& addNode(std::string name)
     {
+        const StatsScope scope {Operation::BUILD};
+
         if (not name.empty()) {
             if (not pimpl) {
                 throw Xml11Exception("Error! Node is not valid! [addNode]");
             }
-            pimpl->addNode(std::move(name));
+            pimpl->emplaceChild(name);
         }
 
         return *this;
@@ -760,6 +993,8 @@ public:
 
     inline Node& addNode(std::string name, std::string value)
     {
+        const StatsScope scope {Operation::BUILD};
+
         if (not name.empty()) {
             if (not pimpl) {
                 throw Xml11Exception("Error! Node is not valid! [addNode]");
@@ -799,6 +1034,8 @@ public:
 
     inline Node& addNodes(const NodeList& nodes)
     {
+        const StatsScope scope {Operation::BUILD};
+
         for (const auto& node : nodes) {
             if (node) {
                 addNode(node);
@@ -810,6 +1047,8 @@ public:
 
     inline Node& addNodes(NodeList&& nodes)
     {
+        const StatsScope scope {Operation::BUILD};
+
         for (auto& node : nodes) {
             if (node) {
                 addNode(std::move(node));
@@ -874,19 +1113,60 @@ public:
 
     inline Node& eraseNodes(const NodeList& nodes)
     {
+        std::unordered_map<const NodeImpl*, size_t> erased;
         for (const auto& node : nodes) {
-            eraseNode(node);
+            if (node) {
+                ++erased[node.pimpl.get()];
+            }
         }
 
+        if (erased.empty()) {
+            return *this;
+        }
+
+        if (not pimpl) {
+            throw Xml11Exception("Error! Node is not valid! [eraseNodes]");
+        }
+
+        pimpl->eraseNodesIf([&erased](const std::shared_ptr<NodeImpl>& node) {
+            const auto it = erased.find(node.get());
+            if (it == erased.end() or it->second == 0) {
+                return false;
+            }
+            --it->second;
+            return true;
+        });
+
         return *this;
     }
 
     inline Node& eraseNodes(NodeList&& nodes)
     {
-        for (auto& node : nodes) {
-            eraseNode(std::move(node));
+        return eraseNodes(static_cast<const NodeList&>(nodes));
+    }
+
+    template <class Predicate>
+    inline Node& eraseNodesIf(Predicate&& predicate)
+    {
+        if (not pimpl) {
+            throw Xml11Exception("Error! Node is not valid! [eraseNodesIf]");
         }
 
+        pimpl->eraseNodesIf([this, &predicate](const std::shared_ptr<NodeImpl>& node) {
+            return static_cast<bool>(predicate(Node {node, m_isCaseInsensitive}));
+        });
+
+        return *this;
+    }
+
+    inline Node& clear()
+    {
+        if (not pimpl) {
+            throw Xml11Exception("Error! Node is not valid! [clear]");
+        }
+
+        pimpl->clearNodes();
+
         return *this;
     }
 
@@ -894,8 +1174,12 @@ public:
     {
         NodeList result;
         if (pimpl) {
+            result.reserve(pimpl->attributes().size() + pimpl->nodes().size());
+            for (const auto& node : pimpl->attributes()) {
+                result.emplace_back(node, m_isCaseInsensitive);
+            }
             for (const auto& node : pimpl->nodes()) {
-                result.emplace_back(node);
+                result.emplace_back(node, m_isCaseInsensitive);
             }
         }
         return result;
@@ -906,12 +1190,43 @@ public:
         return const_cast<Node*>(this)->nodes();
     }
 
+    inline const std::string* attr(const std::string& name) const
+    {
+        const StatsScope scope {Operation::FIND};
+
+        if (not pimpl) {
+            return nullptr;
+        }
+        return m_isCaseInsensitive ? pimpl->attr<CaseInsensitive>(name) : pimpl->attr<CaseSensitive>(name);
+    }
+
+    inline Node& attr(const std::string& name, std::string value)
+    {
+        if (not pimpl) {
+            throw Xml11Exception("Error! Node is not valid! [attr]");
+        }
+        if (m_isCaseInsensitive) {
+            pimpl->attr<CaseInsensitive>(name, std::move(value));
+        }
+        else {
+            pimpl->attr<CaseSensitive>(name, std::move(value));
+        }
+
+        return *this;
+    }
+
+    /********************************************************************************
+     * The name matching mode belongs to the document rather than to its nodes:
+     * it is chosen when the root is created and every Node reached from that
+     * root through lookups carries it along.
+     ********************************************************************************/
+
     inline void isCaseInsensitive(const bool isCaseInsensitive)
     {
         if (not pimpl) {
             throw Xml11Exception("Error! Node is not valid! [isCaseInsensitive]");
         }
-        return pimpl->isCaseInsensitive(isCaseInsensitive);
+        m_isCaseInsensitive = isCaseInsensitive;
     }
 
     inline bool isCaseInsensitive() const
@@ -919,7 +1234,7 @@ public:
         if (not pimpl) {
             throw Xml11Exception("Error! Node is not valid! [isCaseInsensitive]");
         }
-        return pimpl->isCaseInsensitive();
+        return m_isCaseInsensitive;
     }
 
     inline Node clone(const ValueFilter& from = nullptr, const ValueFilter& to = nullptr) const
@@ -928,9 +1243,58 @@ public:
     }
 
 private:
+    friend std::vector<std::string> serializeBatch(
+        const NodeList& nodes,
+        const bool indent,
+        const ValueFilter valueFilter,
+        const size_t threads);
+
     std::shared_ptr<class NodeImpl> pimpl {nullptr};
+    bool m_isCaseInsensitive {true};
 };
 
+/********************************************************************************
+ * Parse or serialize many independent documents at once, e.g. when a queue
+ * is replayed, on several threads (all hardware threads when zero). Results
+ * keep the order of the input, and the first error of any document is
+ * thrown after all the threads have finished.
+ ********************************************************************************/
+
+inline NodeList parseBatch(
+    const std::vector<std::string>& texts,
+    const bool isCaseInsensitive = true,
+    const ValueFilter valueFilter = nullptr,
+    const size_t threads = 0)
+{
+    const StatsScope scope {Operation::PARSE};
+
+    NodeList result;
+    result.reserve(texts.size());
+    for (auto& root : ParseXmlFromTextBatch(texts, valueFilter, threads)) {
+        result.emplace_back(std::move(root), isCaseInsensitive);
+    }
+    return result;
+}
+
+inline std::vector<std::string> serializeBatch(
+    const NodeList& nodes,
+    const bool indent = true,
+    const ValueFilter valueFilter = nullptr,
+    const size_t threads = 0)
+{
+    const StatsScope scope {Operation::SERIALIZE};
+
+    std::vector<std::shared_ptr<NodeImpl>> roots;
+    roots.reserve(nodes.size());
+    for (const auto& node : nodes) {
+        if (not node.pimpl) {
+            throw Xml11Exception("Error! Node is not valid! [serializeBatch]");
+        }
+        roots.emplace_back(node.pimpl);
+    }
+    return ConvertXmlToTextBatch(roots, indent, valueFilter, threads);
+}
+
 namespace literals {
 
 inline Node operator "" _xml(const char* value, size_t size)
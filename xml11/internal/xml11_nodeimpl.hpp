@@ -2,30 +2,104 @@
 
 #include "xml11_associativearray.hpp"
 #include "xml11_node.hpp"
+#include "xml11_stats.hpp"
+
+#include <memory>
+#include <string_view>
 
 namespace xml11 {
 
-class NodeImpl final {
+// The nodes of a lazily parsed document, see xml11_lazy.hpp.
+bool IsLazyNodeParsed(const class NodeImpl& node) noexcept;
+void ParseLazyNode(const class NodeImpl& node, bool isTypeOnly);
+
+class NodeImpl {
 public:
     NodeImpl() = default;
-    NodeImpl(const NodeImpl& node) = default;
-    NodeImpl(NodeImpl&& node) = default;
-    NodeImpl& operator= (const NodeImpl& node) = default;
-    NodeImpl& operator= (NodeImpl&& node) = default;
 
-    inline NodeImpl(std::string name)
-        noexcept(noexcept(AssociativeArray<NodeImpl>()) && noexcept(std::string()))
-        : m_name {std::move(name)}
+    // A copy or a moved node always has its content.
+    inline NodeImpl(const NodeImpl& node)
     {
+        *this = node;
+    }
 
+    inline NodeImpl(NodeImpl&& node)
+    {
+        *this = std::move(node);
     }
 
-    inline NodeImpl(std::string name, std::string text)
-        noexcept(noexcept(AssociativeArray<NodeImpl>()) && noexcept(std::string()))
-        : m_name {std::move(name)},
+    inline NodeImpl& operator= (const NodeImpl& node)
+    {
+        if (this != &node) {
+            node.materialize();
+            m_name = node.m_name;
+            m_text = node.m_text;
+            m_attributes = node.m_attributes;
+            m_nodes = node.m_nodes;
+            m_type = node.m_type;
+            m_isLazy = false;
+        }
+        return *this;
+    }
+
+    inline NodeImpl& operator= (NodeImpl&& node)
+    {
+        if (this != &node) {
+            node.materialize();
+            m_name = std::move(node.m_name);
+            m_text = std::move(node.m_text);
+            m_attributes = std::move(node.m_attributes);
+            m_nodes = std::move(node.m_nodes);
+            m_type = node.m_type;
+            m_isLazy = false;
+        }
+        return *this;
+    }
+
+    inline NodeImpl(const std::string_view name)
+        : m_name {MakeNodeName(name)}
+    {
+        CountNode();
+    }
+
+    inline NodeImpl(const std::string_view name, std::string text)
+        : m_name {MakeNodeName(name)},
+          m_text {std::move(text)}
+    {
+        CountNode();
+    }
+
+#ifdef USE_XML11_NAME_TABLE
+    inline NodeImpl(const Atom name) noexcept
+        : m_name {name}
+    {
+        CountNode();
+    }
+
+    inline NodeImpl(const Atom name, std::string text) noexcept
+        : m_name {name},
           m_text {std::move(text)}
     {
+        CountNode();
+    }
+#endif
+
+    /********************************************************************************
+     * A node of a lazily parsed document is a LazyNodeImpl, which knows only
+     * its name and where its content is. The content is parsed the first time
+     * anything but the name is asked for.
+     ********************************************************************************/
+
+    inline bool isMaterialized() const noexcept
+    {
+        return not m_isLazy or IsLazyNodeParsed(*this);
+    }
 
+    inline void materialize() const
+    {
+        if (m_isLazy) {
+            ParseLazyNode(*this, false);
+        }
     }
 
     /********************************************************************************
@@ -33,159 +107,290 @@ public:
      ********************************************************************************/
 
     template <class T1, class T2>
-    inline void addNode(T1&& name, T2&& value) noexcept
+    inline void addNode(T1&& name, T2&& value)
     {
+        materialize();
         if (name.empty()) {
-            m_text += std::forward<T2>(value);
+            text() += std::forward<T2>(value);
         }
         else {
             m_nodes.insert(std::forward<T1>(name), std::forward<T2>(value));
         }
     }
 
-    inline void addNode(const std::shared_ptr<NodeImpl>& node) noexcept
+    inline void addNode(const std::shared_ptr<NodeImpl>& node)
     {
+        materialize();
         if (node->name().empty()) {
-            m_text += node->text();
+            text() += node->text();
         }
         else {
-            m_nodes.insert(node);
+            CountRefcount();
+            children(*node).insert(node);
         }
     }
 
-    inline void addNode(std::shared_ptr<NodeImpl>&& node) noexcept
+    inline void addNode(std::shared_ptr<NodeImpl>&& node)
     {
+        materialize();
         if (node->name().empty()) {
-            m_text += std::move(node->text());
+            text() += std::move(node->text());
         }
         else {
-            m_nodes.insert(std::move(node));
+            children(*node).insert(std::move(node));
         }
     }
 
-    inline void addNode(const NodeImpl& node) noexcept
+    inline void addNode(const NodeImpl& node)
     {
+        materialize();
         if (node.name().empty()) {
-            m_text += node.text();
+            text() += node.text();
         }
         else {
-            m_nodes.insert(node);
+            children(node).insert(node);
         }
     }
 
-    inline void addNode(NodeImpl&& node) noexcept
+    inline void addNode(NodeImpl&& node)
     {
+        materialize();
         if (node.name().empty()) {
-            m_text += std::move(node.text());
+            text() += std::move(node.text());
         }
         else {
-            m_nodes.insert(std::move(node));
+            children(node).insert(std::move(node));
         }
     }
 
-    template <class T1>
-    inline const std::vector<std::shared_ptr<NodeImpl> > findNodes(T1&& name) const noexcept
+    /********************************************************************************
+     * The child or attribute is built in its final place from the arguments
+     * of a NodeImpl constructor, and the reference stays valid as long as the
+     * node is kept. The name must not be empty.
+     ********************************************************************************/
+
+    template <class... Args>
+    inline NodeImpl& emplaceChild(Args&&... args)
     {
-        return m_nodes.findNodes(std::forward<T1>(name));
+        materialize();
+        return m_nodes.emplace(std::forward<Args>(args)...);
     }
 
-    template <class T1>
-    inline std::vector<std::shared_ptr<NodeImpl> > findNodes(T1&& name) noexcept
+    template <class... Args>
+    inline NodeImpl& emplaceAttribute(Args&&... args)
     {
-        return m_nodes.findNodes(std::forward<T1>(name));
+        materialize();
+        auto& attribute = m_attributes.emplace(std::forward<Args>(args)...);
+        attribute.type(NodeType::ATTRIBUTE);
+        return attribute;
     }
 
-    template <class T1>
-    inline const std::shared_ptr<NodeImpl> findNode(T1&& name) const noexcept
+    template <class CasePolicy>
+    inline std::vector<std::shared_ptr<NodeImpl> > findNodes(const std::string& name) const
     {
-        return m_nodes.findNode(std::forward<T1>(name));
+        materialize();
+        auto result = m_attributes.findNodes<CasePolicy>(name);
+        for (auto&& node : m_nodes.findNodes<CasePolicy>(name)) {
+            result.emplace_back(std::move(node));
+        }
+        return result;
     }
 
-    template <class T1>
-    inline std::shared_ptr<NodeImpl> findNode(T1&& name) noexcept
+    template <class CasePolicy>
+    inline std::shared_ptr<NodeImpl> findNode(const std::string& name) const
     {
-        return m_nodes.findNode(std::forward<T1>(name));
+        materialize();
+        if (auto node = m_attributes.findNode<CasePolicy>(name)) {
+            return node;
+        }
+        return m_nodes.findNode<CasePolicy>(name);
     }
 
     template <class T1>
-    inline void eraseNode(T1&& node) noexcept
+    inline void eraseNode(T1&& node)
+    {
+        materialize();
+        m_attributes.erase(node);
+        m_nodes.erase(node);
+    }
+
+    template <class Predicate>
+    inline size_t eraseNodesIf(Predicate&& predicate)
+    {
+        materialize();
+        return m_attributes.eraseIf(predicate) + m_nodes.eraseIf(predicate);
+    }
+
+    inline void clearNodes()
+    {
+        materialize();
+        m_attributes.clear();
+        m_nodes.clear();
+    }
+
+    /********************************************************************************
+     * Attributes.
+     ********************************************************************************/
+
+    template <class CasePolicy>
+    inline const std::string* attr(const std::string& name) const
     {
-        m_nodes.erase(std::forward<T1>(node));
+        materialize();
+        const auto* node = m_attributes.find<CasePolicy>(name);
+        return node ? &(*node)->text() : nullptr;
+    }
+
+    template <class CasePolicy>
+    inline void attr(const std::string& name, std::string value)
+    {
+        materialize();
+        if (const auto* node = m_attributes.find<CasePolicy>(name)) {
+            (*node)->text(std::move(value));
+        }
+        else {
+            emplaceAttribute(name, std::move(value));
+        }
+    }
+
+    inline const std::vector<std::shared_ptr<NodeImpl> >& attributes() const
+    {
+        materialize();
+        return m_attributes.nodes();
     }
 
     /********************************************************************************
      * Misc functions.
      ********************************************************************************/
 
-    template <class T>
-    inline void name(T&& name) noexcept(noexcept(std::string() = std::string()))
+    inline void name(const std::string_view name)
     {
-        m_name = std::forward<T>(name);
+        m_name = MakeNodeName(name);
     }
 
+#ifndef USE_XML11_NAME_TABLE
     inline std::string& name() noexcept
     {
         return m_name;
     }
+#endif
 
     inline const std::string& name() const noexcept
+    {
+        return NameText(m_name);
+    }
+
+    inline const NodeName& nodeName() const noexcept
     {
         return m_name;
     }
 
     template <class T>
-    inline void text(T&& text) noexcept
+    inline void text(T&& text)
     {
+        materialize();
         m_text = std::forward<T>(text);
     }
 
-    inline std::string& text() noexcept(noexcept(std::string() += std::string()))
+    inline std::string& text()
+    {
+        materialize();
+        return m_text;
+    }
+
+    inline const std::string& text() const
     {
+        materialize();
         return m_text;
     }
 
-    inline const std::string& text() const noexcept(noexcept(std::string() += std::string()))
+    /********************************************************************************
+     * Content reported by a parser. An element holding nothing but CDATA
+     * sections keeps their content alone and becomes of type CDATA. Once text
+     * and sections are mixed, the element stays an ELEMENT and its text reads
+     * as it always has: the text as it is, with the sections in their markers.
+     ********************************************************************************/
+
+    inline void appendText(const std::string_view text)
+    {
+        if (m_type == NodeType::CDATA) {
+            m_text.insert(0, "<![CDATA[").append("]]>");
+            m_type = NodeType::ELEMENT;
+        }
+        m_text += text;
+    }
+
+    inline void appendCData(const std::string_view content)
     {
-        return const_cast<NodeImpl*>(this)->text();
+        if (m_type == NodeType::ELEMENT and m_text.empty()) {
+            m_text = content;
+            m_type = NodeType::CDATA;
+        }
+        else if (m_type == NodeType::CDATA) {
+            m_text += content;
+        }
+        else {
+            m_text.append("<![CDATA[").append(content).append("]]>");
+        }
     }
 
     template <class T>
-    inline void type(T&& type) noexcept
+    inline void type(T&& type)
     {
+        materialize();
         m_type = std::forward<T>(type);
     }
 
-    inline xml11::NodeType& type() noexcept
+    inline xml11::NodeType& type()
     {
+        materialize();
         return m_type;
     }
 
-    inline const NodeType& type() const noexcept
+    // A lazy node is parsed for its type only when it may hold CDATA.
+    inline const NodeType& type() const
     {
+        if (m_isLazy) {
+            ParseLazyNode(*this, true);
+        }
         return m_type;
     }
 
+    // Whatever a lazy node holds, it is an element until it is parsed.
+    inline bool isElement() const
+    {
+        return not isMaterialized() or IsElement(m_type);
+    }
+
+    inline bool isOfType(const NodeType wanted) const
+    {
+        return wanted == NodeType::ELEMENT ? isElement() : type() == wanted;
+    }
+
     inline bool operator == (const NodeImpl& right) const
-        noexcept(noexcept(std::string() == std::string()) &&
-                 noexcept(AssociativeArray<NodeImpl>() == AssociativeArray<NodeImpl>()))
     {
-        if (std::tie(right.m_type, right.m_name, right.m_text) != std::tie(m_type, m_name, m_text)) {
+        materialize();
+        right.materialize();
+
+        if (std::tie(right.m_type, right.m_name) != std::tie(m_type, m_name)) {
             return false;
         }
 
-        if (right.m_nodes.size() != m_nodes.size()) {
+        if (right.m_text != m_text) {
             return false;
         }
 
-        const auto leftNodes = nodes();
-        const auto rightNodes = right.nodes();
-
-        if (rightNodes.size() != leftNodes.size()) {
+        if (right.m_attributes.size() != m_attributes.size() or right.m_nodes.size() != m_nodes.size()) {
             return false;
         }
 
-        for (std::size_t i = 0; i < leftNodes.size(); ++i) {
-            if (*rightNodes[i] != *leftNodes[i]) {
+        for (std::size_t i = 0; i < m_attributes.size(); ++i) {
+            if (*right.attributes()[i] != *attributes()[i]) {
+                return false;
+            }
+        }
+
+        for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+            if (*right.nodes()[i] != *nodes()[i]) {
                 return false;
             }
         }
@@ -194,37 +399,57 @@ public:
     }
 
     inline bool operator != (const NodeImpl& right) const
-        noexcept(noexcept(std::string() == std::string()) &&
-                 noexcept(AssociativeArray<NodeImpl>() == AssociativeArray<NodeImpl>()))
     {
         return not (*this == right);
     }
 
-    inline std::vector<std::shared_ptr<NodeImpl> >& nodes() noexcept
+    inline const std::vector<std::shared_ptr<NodeImpl> >& nodes() const
     {
+        materialize();
         return m_nodes.nodes();
     }
 
-    inline const std::vector<std::shared_ptr<NodeImpl> >& nodes() const noexcept
+protected:
+    // Takes the content parsed for a lazy node. The type is left alone when
+    // it is known without parsing, so that it may be read meanwhile.
+    inline void takeContent(NodeImpl&& parsed, const bool withType)
+    {
+        m_text = std::move(parsed.m_text);
+        m_attributes = std::move(parsed.m_attributes);
+        m_nodes = std::move(parsed.m_nodes);
+        if (withType) {
+            m_type = parsed.m_type;
+        }
+    }
+
+    inline void markLazy() noexcept
     {
-        return const_cast<NodeImpl*>(this)->nodes();
+        m_isLazy = true;
     }
 
-    inline void isCaseInsensitive(const bool isCaseInsensitive) noexcept
+private:
+    static inline bool IsAttribute(const NodeImpl& node)
     {
-        return m_nodes.isCaseInsensitive(isCaseInsensitive);
+        return not node.isElement() and
+            (node.type() == NodeType::ATTRIBUTE or node.type() == NodeType::OPTIONAL_ATTRIBUTE);
     }
 
-    inline bool isCaseInsensitive() const noexcept
+    inline AssociativeArray<NodeImpl>& children(const NodeImpl& node)
     {
-        return m_nodes.isCaseInsensitive();
+        return IsAttribute(node) ? m_attributes : m_nodes;
     }
 
 private:
-    std::string m_name {};
+    // Every node of a tree pays for these, so nothing else belongs here:
+    // the lists are a pointer each until they hold something, the type and
+    // the lazy flag share one word, and the lazy state is in LazyNodeImpl.
+    // That is 88 bytes on 64-bit libstdc++, or 64 with USE_XML11_NAME_TABLE.
+    NodeName m_name {EmptyNodeName()};
     std::string m_text {};
-    NodeType m_type {NodeType::ELEMENT};
+    AssociativeArray<NodeImpl> m_attributes {};
     AssociativeArray<NodeImpl> m_nodes {};
+    NodeType m_type {NodeType::ELEMENT};
+    bool m_isLazy {false};
 };
 
 } // namespace xml11
\ No newline at end of file
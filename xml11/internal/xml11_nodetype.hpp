@@ -2,11 +2,28 @@
 
 namespace xml11 {
     
+    // CDATA and RAW are elements whose text is written as it is stored: the
+    // content of one CDATA section without its markers, or markup that is
+    // already escaped.
     enum class NodeType : char {
         ELEMENT = 0,
         ATTRIBUTE = 1,
         OPTIONAL = 2,
         OPTIONAL_ATTRIBUTE = 3,
+        CDATA = 4,
+        RAW = 5,
     };
 
+    // CDATA and RAW elements differ from ELEMENT only in how their text is
+    // written, so a lookup by ELEMENT finds them too.
+    inline bool IsElement(const NodeType type) noexcept
+    {
+        return type == NodeType::ELEMENT or type == NodeType::CDATA or type == NodeType::RAW;
+    }
+
+    inline bool IsOfType(const NodeType type, const NodeType wanted) noexcept
+    {
+        return wanted == NodeType::ELEMENT ? IsElement(type) : type == wanted;
+    }
+
 } // namespace xml11
\ No newline at end of file
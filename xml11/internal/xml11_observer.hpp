@@ -0,0 +1,119 @@
+#pragma once
+
+#include "xml11_nodeimpl.hpp"
+#include "xml11_stats.hpp"
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace xml11 {
+
+/********************************************************************************
+ * Optional observer of parsing and serialization.
+ *
+ * When one is set, every call to ParseXmlFromText and ConvertXmlToText
+ * reports its input or output size, the number of nodes in the document, the
+ * backend and how long it took. When none is set the cost is a single test
+ * of an empty std::function. The observer is process-wide: set it at
+ * startup, before any thread works with documents. Batches report every
+ * document from the worker thread that handled it, so the observer must be
+ * safe to call from several threads at once. A lazy parse is reported once,
+ * for the whole text, and the children read later are not reported.
+ ********************************************************************************/
+
+enum class Backend : unsigned char {
+    LIBXML2,
+    RAPIDXML,
+};
+
+struct ObserverEvent final {
+    Operation operation {Operation::NONE};
+    Backend backend {Backend::LIBXML2};
+    size_t bytes {0};
+    size_t nodes {0};
+    std::chrono::nanoseconds duration {0};
+};
+
+using Observer = std::function<void (const ObserverEvent& event)>;
+
+inline Observer& GlobalObserver() noexcept
+{
+    static Observer observer;
+    return observer;
+}
+
+inline void setObserver(Observer observer)
+{
+    GlobalObserver() = std::move(observer);
+}
+
+// The children of a lazily parsed document that were not read yet are
+// counted as one node each, so that counting them parses nothing.
+inline size_t CountNodes(const NodeImpl& root)
+{
+    if (not root.isMaterialized()) {
+        return 1;
+    }
+
+    size_t result = 1 + root.attributes().size();
+    for (const auto& node : root.nodes()) {
+        result += CountNodes(*node);
+    }
+    return result;
+}
+
+template <class Function>
+inline std::shared_ptr<NodeImpl> ObserveParse(
+    const Backend backend,
+    const std::string& text,
+    Function&& parse)
+{
+    const auto& observer = GlobalObserver();
+    if (not observer) {
+        return parse();
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    auto root = parse();
+    const auto finish = std::chrono::steady_clock::now();
+
+    observer(ObserverEvent {
+        Operation::PARSE,
+        backend,
+        text.size(),
+        root ? CountNodes(*root) : 0,
+        finish - start
+    });
+
+    return root;
+}
+
+template <class Function>
+inline std::string ObserveSerialize(
+    const Backend backend,
+    const std::shared_ptr<NodeImpl>& root,
+    Function&& serialize)
+{
+    const auto& observer = GlobalObserver();
+    if (not observer) {
+        return serialize();
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    auto text = serialize();
+    const auto finish = std::chrono::steady_clock::now();
+
+    observer(ObserverEvent {
+        Operation::SERIALIZE,
+        backend,
+        text.size(),
+        root ? CountNodes(*root) : 0,
+        finish - start
+    });
+
+    return text;
+}
+
+} // namespace xml11
@@ -0,0 +1,457 @@
+#pragma once
+
+#include "xml11_nodeimpl.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace xml11 {
+
+// Where the parts of a document are, as found by ScanDocument.
+struct DocumentLayout final {
+    std::string_view prolog {};
+    std::string_view rootStartTag {};
+    std::string_view rootName {};
+    std::vector<std::string_view> children {};
+};
+
+namespace {
+
+/********************************************************************************
+ * Parallel parsing of large documents.
+ *
+ * Exports usually are one root with a long list of records under it. A quick
+ * structural scan finds where each child of the root begins and ends, the
+ * children are split into contiguous runs of about the same size, and every
+ * run is parsed on its own thread inside a copy of the root's start tag, so
+ * the prolog, encoding and namespace declarations still apply. The parsed
+ * children are then attached to the root in document order.
+ *
+ * Documents the scan does not fully understand (text, comments or processing
+ * instructions directly under the root, a DTD internal subset) are parsed by
+ * a single call instead, so the result is always the sequential one.
+ *
+ * Serialization of wide trees works the other way round: runs of the
+ * root's children are rendered on their own threads, each inside a copy of
+ * the root with the same attributes, and the texts between the root's start
+ * and end tags are joined in order.
+ *
+ * Batches of independent documents use the same workers: each one takes the
+ * next document from a shared counter, so a thread that got small documents
+ * keeps taking more while another is busy with a large one.
+ ********************************************************************************/
+
+static inline bool IsBlank(const std::string_view text) noexcept
+{
+    for (const auto c : text) {
+        if (not std::isspace(static_cast<unsigned char>(c))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static inline size_t SkipPast(const std::string_view text, const size_t pos, const std::string_view terminator) noexcept
+{
+    const auto found = text.find(terminator, pos);
+    return found == std::string_view::npos ? found : found + terminator.size();
+}
+
+// Returns the position after the '>' closing the tag that starts at pos,
+// skipping quoted attribute values which may contain '>' as well.
+static inline size_t SkipTag(const std::string_view text, size_t pos) noexcept
+{
+    char quote = 0;
+    for (++pos; pos < text.size(); ++pos) {
+        const auto c = text[pos];
+        if (quote) {
+            if (c == quote) {
+                quote = 0;
+            }
+        }
+        else if (c == '"' or c == '\'') {
+            quote = c;
+        }
+        else if (c == '>') {
+            return pos + 1;
+        }
+    }
+    return std::string_view::npos;
+}
+
+// memchr is vectorized by the C library, so most of the text is skipped
+// many bytes at a time.
+static inline size_t FindTagStart(const std::string_view text, const size_t pos) noexcept
+{
+    if (pos >= text.size()) {
+        return std::string_view::npos;
+    }
+    const auto found = static_cast<const char*>(std::memchr(text.data() + pos, '<', text.size() - pos));
+    return found ? static_cast<size_t>(found - text.data()) : std::string_view::npos;
+}
+
+static inline bool StartsWith(const std::string_view text, const size_t pos, const std::string_view prefix) noexcept
+{
+    return text.compare(pos, prefix.size(), prefix) == 0;
+}
+
+// Whether the tag is </name>, with optional whitespace before the '>'.
+static inline bool IsEndTagOf(std::string_view tag, const std::string_view name) noexcept
+{
+    tag.remove_prefix(2);
+    tag.remove_suffix(1);
+    return StartsWith(tag, 0, name) and IsBlank(tag.substr(name.size()));
+}
+
+// Only whitespace, comments and processing instructions may follow the root.
+static inline bool IsMiscOnly(const std::string_view text) noexcept
+{
+    for (size_t pos = 0; pos != std::string_view::npos;) {
+        const auto tag = FindTagStart(text, pos);
+        if (not IsBlank(text.substr(pos, tag == std::string_view::npos ? std::string_view::npos : tag - pos))) {
+            return false;
+        }
+        if (tag == std::string_view::npos) {
+            return true;
+        }
+        if (StartsWith(text, tag, "<!--")) {
+            pos = SkipPast(text, tag, "-->");
+        }
+        else if (StartsWith(text, tag, "<?")) {
+            pos = SkipPast(text, tag, "?>");
+        }
+        else {
+            return false;
+        }
+    }
+    return false;
+}
+
+static inline std::optional<DocumentLayout> ScanDocument(const std::string_view text)
+{
+    constexpr auto npos = std::string_view::npos;
+
+    DocumentLayout layout;
+
+    size_t pos = 0;
+    for (;;) {
+        pos = FindTagStart(text, pos);
+        if (pos == npos) {
+            return std::nullopt;
+        }
+
+        if (StartsWith(text, pos, "<?")) {
+            pos = SkipPast(text, pos, "?>");
+        }
+        else if (StartsWith(text, pos, "<!--")) {
+            pos = SkipPast(text, pos, "-->");
+        }
+        else if (StartsWith(text, pos, "<!")) {
+            const auto end = SkipTag(text, pos);
+            if (end == npos or text.substr(pos, end - pos).find('[') != npos) {
+                return std::nullopt;
+            }
+            pos = end;
+        }
+        else {
+            break;
+        }
+
+        if (pos == npos) {
+            return std::nullopt;
+        }
+    }
+
+    const auto rootBegin = pos;
+    const auto rootEnd = SkipTag(text, rootBegin);
+    if (rootEnd == npos or text[rootEnd - 2] == '/') {
+        return std::nullopt;
+    }
+
+    const auto nameEnd = text.find_first_of(" \t\r\n/>", rootBegin + 1);
+    layout.prolog = text.substr(0, rootBegin);
+    layout.rootStartTag = text.substr(rootBegin, rootEnd - rootBegin);
+    layout.rootName = text.substr(rootBegin + 1, nameEnd - rootBegin - 1);
+
+    size_t depth = 1;
+    size_t childBegin = npos;
+
+    for (pos = rootEnd; depth;) {
+        const auto tag = FindTagStart(text, pos);
+        if (tag == npos) {
+            return std::nullopt;
+        }
+
+        if (depth == 1 and not IsBlank(text.substr(pos, tag - pos))) {
+            return std::nullopt;
+        }
+
+        if (StartsWith(text, tag, "<!--") or StartsWith(text, tag, "<?") or StartsWith(text, tag, "<![CDATA[")) {
+            if (depth == 1) {
+                return std::nullopt;
+            }
+            pos = StartsWith(text, tag, "<!--") ? SkipPast(text, tag, "-->")
+                : StartsWith(text, tag, "<?") ? SkipPast(text, tag, "?>")
+                : SkipPast(text, tag, "]]>");
+        }
+        else if (StartsWith(text, tag, "</")) {
+            pos = SkipTag(text, tag);
+            if (--depth == 1 and pos != npos) {
+                layout.children.emplace_back(text.substr(childBegin, pos - childBegin));
+            }
+            if (depth == 0 and pos != npos and not IsEndTagOf(text.substr(tag, pos - tag), layout.rootName)) {
+                return std::nullopt;
+            }
+        }
+        else {
+            pos = SkipTag(text, tag);
+            if (pos == npos) {
+                return std::nullopt;
+            }
+            const bool isEmptyElement = text[pos - 2] == '/';
+            if (depth == 1) {
+                childBegin = tag;
+                if (isEmptyElement) {
+                    layout.children.emplace_back(text.substr(tag, pos - tag));
+                }
+            }
+            if (not isEmptyElement) {
+                ++depth;
+            }
+        }
+
+        if (pos == npos) {
+            return std::nullopt;
+        }
+    }
+
+    if (not IsMiscOnly(text.substr(pos))) {
+        return std::nullopt;
+    }
+
+    return layout;
+}
+
+// A document of its own with the root's start tag, so the prolog, encoding
+// and namespace declarations still apply to the body.
+static inline std::string WrapInRoot(const DocumentLayout& layout, const std::string_view body)
+{
+    std::string result;
+    result.reserve(layout.prolog.size() + layout.rootStartTag.size() + body.size() + layout.rootName.size() + 3);
+    result += layout.prolog;
+    result += layout.rootStartTag;
+    result += body;
+    result += "</";
+    result += layout.rootName;
+    result += '>';
+    return result;
+}
+
+// Zero threads means one per hardware thread; there are never more threads
+// than tasks.
+static inline size_t ThreadsCount(
+    const size_t threads,
+    const size_t tasks = std::numeric_limits<size_t>::max()) noexcept
+{
+    const size_t available = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+    return std::max<size_t>(1, std::min(available, tasks));
+}
+
+template <class Function>
+inline void RunInParallel(const size_t tasks, const size_t threads, Function&& task)
+{
+    std::atomic<size_t> next {0};
+    std::exception_ptr failure {nullptr};
+    std::mutex mutex;
+
+    const auto worker = [&] {
+        for (size_t i = next++; i < tasks; i = next++) {
+            try {
+                task(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock {mutex};
+                if (not failure) {
+                    failure = std::current_exception();
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+// The parse function turns a complete document into a tree and must be safe
+// to call from several threads at once.
+template <class Function>
+inline std::shared_ptr<NodeImpl> ParseInParallel(
+    const std::string& text,
+    size_t threads,
+    Function&& parse)
+{
+    threads = ThreadsCount(threads);
+
+    const auto layout = threads > 1 ? ScanDocument(text) : std::nullopt;
+    if (not layout or layout->children.size() < 2) {
+        return parse(text);
+    }
+
+    const auto& children = layout->children;
+    const auto span = [&children](const size_t first, const size_t last) {
+        const auto end = children[last].data() + children[last].size();
+        return std::string_view {children[first].data(), static_cast<size_t>(end - children[first].data())};
+    };
+
+    const auto chunksCount = std::min(children.size(), threads * 4);
+    const auto bytesPerChunk = span(0, children.size() - 1).size() / chunksCount + 1;
+
+    std::vector<std::string_view> chunks;
+    chunks.reserve(chunksCount);
+    for (size_t first = 0, last = 0; first < children.size(); first = last) {
+        last = first + 1;
+        while (last < children.size() and span(first, last).size() <= bytesPerChunk) {
+            ++last;
+        }
+        chunks.emplace_back(span(first, last - 1));
+    }
+
+    std::vector<std::shared_ptr<NodeImpl>> parts(chunks.size() + 1);
+    RunInParallel(chunks.size() + 1, ThreadsCount(threads, chunks.size() + 1), [&](const size_t i) {
+        parts[i] = parse(WrapInRoot(*layout, i ? chunks[i - 1] : std::string_view {}));
+        if (not parts[i]) {
+            throw Xml11Exception("Error! Failed to parse a part of the document! [ParseInParallel]");
+        }
+    });
+
+    const auto& root = parts[0];
+    for (size_t i = 1; i < parts.size(); ++i) {
+        for (const auto& node : parts[i]->nodes()) {
+            root->addNode(node);
+        }
+    }
+
+    return root;
+}
+
+// The serialize function renders a complete document and must be safe to
+// call from several threads at once.
+template <class Function>
+inline std::string SerializeInParallel(
+    const std::shared_ptr<NodeImpl>& root,
+    size_t threads,
+    Function&& serialize)
+{
+    threads = ThreadsCount(threads);
+
+    const auto& children = root->nodes();
+    if (threads < 2 or children.size() < 2 or not root->text().empty()) {
+        return serialize(root);
+    }
+
+    const auto chunksCount = std::min(children.size(), threads * 4);
+    const auto chunkBegin = [&children, chunksCount](const size_t chunk) {
+        return chunk * children.size() / chunksCount;
+    };
+
+    const auto shell = [&root, &children](const size_t first, const size_t last) {
+        const auto result = std::make_shared<NodeImpl>(root->name());
+        for (const auto& attribute : root->attributes()) {
+            result->addNode(attribute);
+        }
+        for (size_t i = first; i < last; ++i) {
+            result->addNode(children[i]);
+        }
+        return result;
+    };
+
+    // Part 0 is the root without children: the '/>' of the empty element is
+    // at the same offset as the '>' ending the start tag of every other part.
+    std::vector<std::string> parts(chunksCount + 1);
+    RunInParallel(chunksCount + 1, ThreadsCount(threads, chunksCount + 1), [&](const size_t i) {
+        parts[i] = serialize(i ? shell(chunkBegin(i - 1), chunkBegin(i)) : shell(0, 0));
+    });
+
+    const auto startTagEnd = parts[0].rfind("/>");
+    const auto endTag = "</" + root->name() + ">";
+    if (startTagEnd == std::string::npos) {
+        throw Xml11Exception("Error! Unexpected layout of a serialized part! [SerializeInParallel]");
+    }
+
+    std::vector<std::string_view> bodies;
+    bodies.reserve(chunksCount);
+    size_t size = 0;
+    for (size_t i = 1; i < parts.size(); ++i) {
+        const std::string_view part {parts[i]};
+        const auto begin = startTagEnd + (part[startTagEnd + 1] == '\n' ? 2 : 1);
+        const auto end = part.rfind(endTag);
+        if (part.compare(0, startTagEnd, parts[0], 0, startTagEnd) != 0 or end == std::string_view::npos or end < begin) {
+            throw Xml11Exception("Error! Unexpected layout of a serialized part! [SerializeInParallel]");
+        }
+        bodies.emplace_back(part.substr(begin, end - begin));
+        size += bodies.back().size();
+    }
+
+    const std::string_view first {parts[1]};
+    const std::string_view last {parts.back()};
+    const auto head = first.substr(0, bodies.front().data() - first.data());
+    const auto tail = last.substr(bodies.back().data() + bodies.back().size() - last.data());
+
+    std::string result;
+    result.reserve(head.size() + size + tail.size());
+    result += head;
+    for (const auto body : bodies) {
+        result += body;
+    }
+    result += tail;
+
+    return result;
+}
+
+// Every worker creates one Context and passes it to the task for each input
+// it takes; the context is destroyed when the worker has nothing left to do.
+template <class Result, class Context, class Input, class Function>
+inline std::vector<Result> RunBatch(
+    const std::vector<Input>& inputs,
+    const size_t threads,
+    Function&& task)
+{
+    std::vector<Result> result(inputs.size());
+    std::atomic<size_t> next {0};
+
+    const auto workers = ThreadsCount(threads, inputs.size());
+    RunInParallel(workers, workers, [&](const size_t) {
+        Context context {};
+        for (size_t i = next++; i < inputs.size(); i = next++) {
+            result[i] = task(context, inputs[i]);
+        }
+    });
+
+    return result;
+}
+
+} // anonymous namespace
+
+} // namespace xml11
@@ -2,9 +2,135 @@
 
 #define RAPIDXML_NO_STREAMS
 
+#include <cstddef>
+
+namespace xml11 {
+inline size_t RapidXmlBlockSize() noexcept;
+}
+
+// Dynamic pool blocks take their size from the pool options at run time.
+#ifndef RAPIDXML_DYNAMIC_POOL_SIZE
+#define RAPIDXML_DYNAMIC_POOL_SIZE (::xml11::RapidXmlBlockSize())
+#endif
+
 #include "rapidxml.hpp"
+#include "xml11_escape.hpp"
+#include "xml11_filters.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace xml11 {
+
+namespace {
+
+/********************************************************************************
+ * rapidxml::print writes one character at a time through its output
+ * iterator and expands every value character by character. With this
+ * iterator the overloads below append names, indentation and the clean
+ * runs of values to the string in one piece instead.
+ ********************************************************************************/
+
+class StringOutput final {
+public:
+    using iterator_category = std::output_iterator_tag;
+    using value_type = void;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = void;
+
+    inline explicit StringOutput(std::string& text) noexcept
+        : m_text {&text}
+    {
+    }
+
+    inline StringOutput& operator = (const char c)
+    {
+        m_text->push_back(c);
+        return *this;
+    }
+
+    inline StringOutput& operator * () noexcept
+    {
+        return *this;
+    }
+
+    inline StringOutput& operator ++ () noexcept
+    {
+        return *this;
+    }
+
+    inline StringOutput operator ++ (int) noexcept
+    {
+        return *this;
+    }
+
+    inline std::string& text() const noexcept
+    {
+        return *m_text;
+    }
+
+private:
+    std::string* m_text {nullptr};
+};
+
+// Text of RAW nodes is given to rapidxml as CDATA nodes with this name and
+// written without the CDATA markers.
+static constexpr char RAW_TEXT[] = "xml11:raw";
+
+} /* anonymous namespace */
+
+} /* namespace xml11 */
 
 namespace rapidxml { namespace internal {
+
+inline xml11::StringOutput copy_chars(const char* begin, const char* end, xml11::StringOutput out)
+{
+    out.text().append(begin, end);
+    return out;
+}
+
+inline xml11::StringOutput fill_chars(xml11::StringOutput out, int n, char ch)
+{
+    out.text().append(static_cast<size_t>(n), ch);
+    return out;
+}
+
+// Expands the same characters rapidxml does, except the quote which does
+// not delimit the value.
+inline xml11::StringOutput copy_and_expand_chars(const char* begin, const char* end, char noexpand, xml11::StringOutput out)
+{
+    char specials[5];
+    size_t count = 0;
+    for (const auto c : {'<', '>', '\'', '"', '&'}) {
+        if (c != noexpand) {
+            specials[count++] = c;
+        }
+    }
+
+    xml11::AppendEscaped(
+        out.text(),
+        std::string_view {begin, static_cast<size_t>(end - begin)},
+        std::string_view {specials, count},
+        [](const char c) -> std::string_view {
+            switch (c) {
+            case '<': return "&lt;";
+            case '>': return "&gt;";
+            case '\'': return "&apos;";
+            case '"': return "&quot;";
+            default: return "&amp;";
+            }
+        });
+
+    return out;
+}
+
 template<class OutIt, class Ch>
 inline OutIt print_children(OutIt out, const rapidxml::xml_node<Ch> *node, int flags, int indent);
 
@@ -31,117 +157,414 @@ inline OutIt print_doctype_node(OutIt out, const rapidxml::xml_node<Ch> *node, i
 
 template<class OutIt, class Ch>
 inline OutIt print_pi_node(OutIt out, const rapidxml::xml_node<Ch> *node, int flags, int indent);
+
+inline xml11::StringOutput print_cdata_node(xml11::StringOutput out, const rapidxml::xml_node<char> *node, int flags, int indent);
+
+inline xml11::StringOutput print_element_node(xml11::StringOutput out, const rapidxml::xml_node<char> *node, int flags, int indent);
 }}
 
 #include "rapidxml_print.hpp"
 
+namespace rapidxml { namespace internal {
+
+inline xml11::StringOutput print_cdata_node(xml11::StringOutput out, const rapidxml::xml_node<char> *node, int flags, int indent)
+{
+    if (node->name() != xml11::RAW_TEXT) {
+        return print_cdata_node<xml11::StringOutput, char>(out, node, flags, indent);
+    }
+
+    if (!(flags & print_no_indenting)) {
+        out = fill_chars(out, indent, '\t');
+    }
+    return copy_chars(node->value(), node->value() + node->value_size(), out);
+}
+
+// An element holding nothing but CDATA and raw text is written on one line,
+// the way rapidxml writes an element with a sole data node.
+inline xml11::StringOutput print_element_node(xml11::StringOutput out, const rapidxml::xml_node<char> *node, int flags, int indent)
+{
+    auto* other = node->first_node();
+    while (other and other->type() == node_cdata) {
+        other = other->next_sibling();
+    }
+    if (not node->first_node() or other) {
+        return print_element_node<xml11::StringOutput, char>(out, node, flags, indent);
+    }
+
+    if (!(flags & print_no_indenting)) {
+        out = fill_chars(out, indent, '\t');
+    }
+    out.text() += '<';
+    out = copy_chars(node->name(), node->name() + node->name_size(), out);
+    out = print_attributes(out, node, flags);
+    out.text() += '>';
+    for (const auto* child = node->first_node(); child; child = child->next_sibling()) {
+        out = print_cdata_node(out, child, print_no_indenting, 0);
+    }
+    out.text() += "</";
+    out = copy_chars(node->name(), node->name() + node->name_size(), out);
+    out.text() += '>';
+    return out;
+}
+
+}}
+
+#include "xml11_observer.hpp"
+#include "xml11_parallel.hpp"
+#include "xml11_stats.hpp"
+
 namespace xml11 {
 
+/********************************************************************************
+ * Reusable rapidxml documents.
+ *
+ * An xml_document carries a static pool of RAPIDXML_STATIC_POOL_SIZE bytes
+ * and allocates dynamic blocks when that is exhausted. Every thread keeps
+ * one document, and the blocks it frees go to a cache of the thread instead
+ * of the heap, so the next parse or serialization starts with the memory the
+ * previous one has grown. The size of the blocks and how much memory a
+ * thread may keep are options that can be changed at run time; the static
+ * pool size remains a compile-time macro.
+ ********************************************************************************/
+
+struct PoolOptions final {
+    size_t blockSize {64 * 1024};
+    size_t maxRetainedBytes {4 * 1024 * 1024};
+};
+
+// Every parsing thread reads the options, so they are kept in atomics and
+// may be changed at any time. A change applies to the blocks allocated and
+// released after it.
+inline std::atomic<size_t>& PoolBlockSize() noexcept
+{
+    static std::atomic<size_t> blockSize {PoolOptions {}.blockSize};
+    return blockSize;
+}
+
+inline std::atomic<size_t>& PoolMaxRetainedBytes() noexcept
+{
+    static std::atomic<size_t> maxRetainedBytes {PoolOptions {}.maxRetainedBytes};
+    return maxRetainedBytes;
+}
+
+inline void setPoolOptions(const PoolOptions options) noexcept
+{
+    PoolBlockSize().store(options.blockSize, std::memory_order_relaxed);
+    PoolMaxRetainedBytes().store(options.maxRetainedBytes, std::memory_order_relaxed);
+}
+
+inline PoolOptions poolOptions() noexcept
+{
+    return {
+        PoolBlockSize().load(std::memory_order_relaxed),
+        PoolMaxRetainedBytes().load(std::memory_order_relaxed),
+    };
+}
+
+inline size_t RapidXmlBlockSize() noexcept
+{
+    return PoolBlockSize().load(std::memory_order_relaxed);
+}
+
+namespace {
+
+class PoolBlocks final {
+public:
+    PoolBlocks(const PoolBlocks&) = delete;
+    PoolBlocks& operator = (const PoolBlocks&) = delete;
+
+    inline PoolBlocks() noexcept = default;
+
+    inline ~PoolBlocks() noexcept
+    {
+        for (auto* block : m_free) {
+            std::free(block);
+        }
+    }
+
+    static inline PoolBlocks& local() noexcept
+    {
+        thread_local PoolBlocks blocks;
+        return blocks;
+    }
+
+    static inline void* allocate(const std::size_t size)
+    {
+        return local().take(size);
+    }
+
+    static inline void release(void* const memory) noexcept
+    {
+        local().give(memory);
+    }
+
+private:
+    struct alignas(std::max_align_t) Header final {
+        size_t size {0};
+    };
+
+    inline void* take(const size_t size)
+    {
+        for (size_t i = 0; i < m_free.size(); ++i) {
+            if (m_free[i]->size >= size) {
+                auto* const block = m_free[i];
+                m_free[i] = m_free.back();
+                m_free.pop_back();
+                m_retained -= block->size;
+                return block + 1;
+            }
+        }
+
+        CountAllocation(size);
+        auto* const block = static_cast<Header*>(std::malloc(sizeof(Header) + size));
+        if (not block) {
+            throw std::bad_alloc {};
+        }
+        block->size = size;
+        return block + 1;
+    }
+
+    // Called while a document is cleared, so it never throws: a block the
+    // cache cannot keep goes back to the heap.
+    inline void give(void* const memory) noexcept
+    {
+        auto* const block = static_cast<Header*>(memory) - 1;
+        if (m_retained + block->size > PoolMaxRetainedBytes().load(std::memory_order_relaxed)) {
+            std::free(block);
+            return;
+        }
+
+        try {
+            m_free.push_back(block);
+            m_retained += block->size;
+        } catch (...) {
+            std::free(block);
+        }
+    }
+
+    std::vector<Header*> m_free {};
+    size_t m_retained {0};
+};
+
+struct LocalDocument final {
+    rapidxml::xml_document<> document {};
+    bool isBusy {false};
+
+    inline LocalDocument() noexcept
+    {
+        document.set_allocator(PoolBlocks::allocate, PoolBlocks::release);
+    }
+
+    static inline LocalDocument& get() noexcept
+    {
+        // The block cache is created first, so it is destroyed after the
+        // document which still hands blocks back to it.
+        PoolBlocks::local();
+        thread_local LocalDocument local;
+        return local;
+    }
+};
+
+// Borrows the document of the thread for one parse or serialization and
+// clears it afterwards. A nested call, e.g. from a value filter, gets a
+// document of its own.
+class RapidXmlDocument final {
+public:
+    RapidXmlDocument(const RapidXmlDocument&) = delete;
+    RapidXmlDocument& operator = (const RapidXmlDocument&) = delete;
+
+    inline RapidXmlDocument()
+    {
+        auto& local = LocalDocument::get();
+        if (local.isBusy) {
+            m_owned = std::make_unique<LocalDocument>();
+            m_document = &m_owned->document;
+        }
+        else {
+            local.isBusy = true;
+            m_local = &local;
+            m_document = &local.document;
+        }
+    }
+
+    inline ~RapidXmlDocument() noexcept
+    {
+        m_document->clear();
+        if (m_local) {
+            m_local->isBusy = false;
+        }
+    }
+
+    inline rapidxml::xml_document<>& get() noexcept
+    {
+        return *m_document;
+    }
+
+private:
+    std::unique_ptr<LocalDocument> m_owned {nullptr};
+    LocalDocument* m_local {nullptr};
+    rapidxml::xml_document<>* m_document {nullptr};
+};
+
+} /* anonymous namespace */
+
 namespace {
 
+// The document is parsed without modifying the text, so names and values
+// point into it and entities are still there: they are replaced while the
+// values are copied into the nodes.
+template<class Filter>
+static inline std::string ValueOf(const rapidxml::xml_base<>* const node, const Filter& filter)
+{
+    auto value = Unescape(std::string_view {node->value(), node->value_size()});
+    filter(value);
+    return value;
+}
+
+template<class Filter>
 void ParseXmlFromText_(
     NodeImpl& root,
-    const bool isCaseInsensitive,
-    const ValueFilter& valueFilter,
+    const Filter& filter,
     const rapidxml::xml_node<>* const node)
 {
     for (const auto* n = node->first_attribute(); n; n = n->next_attribute()) {
-        NodeImpl new_node {n->name(), valueFilter ? GenerateString(n->value(), valueFilter) : n->value()};
-        new_node.type(NodeType::ATTRIBUTE);
-        new_node.isCaseInsensitive(isCaseInsensitive);
-        root.addNode(std::move(new_node));
+        root.emplaceAttribute(
+            std::string_view {n->name(), n->name_size()},
+            ValueOf(n, filter));
     }
 
     for (const auto* n = node->first_node(); n; n = n->next_sibling()) {
-        NodeImpl new_node {n->name(), valueFilter ? GenerateString(n->value(), valueFilter) : n->value()};
-        new_node.type(NodeType::ELEMENT);
-        new_node.isCaseInsensitive(isCaseInsensitive);
-        ParseXmlFromText_(new_node, isCaseInsensitive, valueFilter, n);
-        root.addNode(std::move(new_node));
+        if (n->type() == rapidxml::node_element) {
+            auto& new_node = root.emplaceChild(std::string_view {n->name(), n->name_size()});
+            ParseXmlFromText_(new_node, filter, n);
+        }
+        else if (n->type() == rapidxml::node_data) {
+            root.appendText(ValueOf(n, filter));
+        }
+        else if (n->type() == rapidxml::node_cdata) {
+            const std::string_view content {n->value(), n->value_size()};
+            if constexpr (IS_NO_FILTER<Filter>) {
+                root.appendCData(content);
+            }
+            else {
+                std::string value {content};
+                filter(value);
+                root.appendCData(value);
+            }
+        }
+    }
+}
+
+// The text must live until the document is printed.
+void AppendText(
+    rapidxml::xml_document<>& doc,
+    rapidxml::xml_node<>* const element,
+    const NodeType type,
+    const std::string_view text)
+{
+    using namespace rapidxml;
+
+    if (type == NodeType::CDATA) {
+        ForEachCDataSection(text, [&doc, element](const std::string_view section) {
+            element->append_node(doc.allocate_node(node_cdata, nullptr, section.data(), 0, section.size()));
+        });
+    }
+    else if (type == NodeType::RAW) {
+        element->append_node(doc.allocate_node(node_cdata, RAW_TEXT, text.data(), 0, text.size()));
+    }
+    else {
+        element->append_node(doc.allocate_node(node_data, nullptr, text.data(), 0, text.size()));
     }
 }
 
+template<class Filter>
+std::string_view TextOf(rapidxml::xml_document<>& doc, const NodeImpl& node, const Filter& filter)
+{
+    if constexpr (IS_NO_FILTER<Filter>) {
+        return node.text();
+    }
+    else {
+        const auto text = FilteredCopy(node.text(), filter);
+        return {doc.allocate_string(text.data(), text.size()), text.size()};
+    }
+}
+
+template<class Filter>
 void ConvertXmlToText_(
     rapidxml::xml_document<>& doc,
     rapidxml::xml_node<>* const root,
-    const ValueFilter& valueFilter,
+    const Filter& filter,
     const std::shared_ptr<NodeImpl>& nodeImpl)
 {
     using namespace rapidxml;
 
-    xml_node<>* new_node {nullptr};
-    xml_attribute<>* new_attribute {nullptr};
+    for (const auto& node : nodeImpl->attributes()) {
+        if (not node) {
+            continue;
+        }
+        const auto value = TextOf(doc, *node, filter);
+        root->append_attribute(
+            doc.allocate_attribute(
+                node->name().c_str(),
+                value.data(),
+                0,
+                value.size()));
+    }
 
     for (const auto& node : nodeImpl->nodes()) {
-        switch (node->type()) {
-        case NodeType::OPTIONAL:
-        case NodeType::ELEMENT:
-            if (not node) {
-                break;
-            }
-            new_node = doc.allocate_node(
-                    node_element,
-                    node->name().c_str(),
-                    nullptr);
-
-            if (not node->text().empty()) {
-                new_node->append_node(
-                        doc.allocate_node(
-                            node_data,
-                            nullptr,
-                            valueFilter ? GenerateString(node->text(), valueFilter).c_str() : node->text().c_str()));
-            }
-
-            ConvertXmlToText_(doc, new_node, valueFilter, node);
+        if (not node) {
+            continue;
+        }
+        xml_node<>* const new_node = doc.allocate_node(
+                node_element,
+                node->name().c_str(),
+                nullptr);
 
-            root->append_node(new_node);
-            break;
-        case NodeType::OPTIONAL_ATTRIBUTE:
-        case NodeType::ATTRIBUTE:
-            if (not node) {
-                break;
-            }
-            new_attribute = doc.allocate_attribute(
-                    node->name().c_str(),
-                    valueFilter ? GenerateString(node->text(), valueFilter).c_str() : node->text().c_str());
-            root->append_attribute(new_attribute);
-            break;
+        if (not node->text().empty()) {
+            AppendText(doc, new_node, node->type(), TextOf(doc, *node, filter));
         }
+
+        ConvertXmlToText_(doc, new_node, filter, node);
+
+        root->append_node(new_node);
     }
 }
 
-} /* anonymous namespace */
-
-inline std::shared_ptr<NodeImpl> ParseXmlFromText(
+template<class Filter>
+inline std::shared_ptr<NodeImpl> ParseXmlFromText__(
     const std::string& text,
-    const bool isCaseInsensitive,
-    const ValueFilter& valueFilter,
-    const bool )
+    const Filter& filter)
 {
     using namespace rapidxml;
 
+    static_assert(IsInPlaceFilter<Filter>::value, "the filter must change a std::string in place");
+
     if (text.empty()) {
         return nullptr;
     }
 
     try {
 
-        xml_document<> doc;
+        RapidXmlDocument document;
+        auto& doc = document.get();
 
-        doc.parse<parse_full | parse_no_data_nodes>(const_cast<char*>(text.data()));
+        // rapidxml takes a mutable pointer, but does not write through it
+        // in the non-destructive mode. The text is zero-terminated.
+        doc.parse<parse_full | parse_non_destructive>(const_cast<char*>(text.c_str()));
 
         auto node = doc.first_node();
-        if (node->next_sibling()) {
+        while (node and node->type() != node_element) {
             node = node->next_sibling();
         }
+        if (not node) {
+            return nullptr;
+        }
 
         const std::shared_ptr<NodeImpl> root =
             std::make_shared<NodeImpl>(
-                reinterpret_cast<const char*>(node->name()));
-
-        root->isCaseInsensitive(isCaseInsensitive);
+                std::string_view {node->name(), node->name_size()});
 
-        ParseXmlFromText_(*root, isCaseInsensitive, valueFilter, node);
+        ParseXmlFromText_(*root, filter, node);
 
         return root;
 
@@ -152,17 +575,20 @@ inline std::shared_ptr<NodeImpl> ParseXmlFromText(
     return nullptr;
 }
 
-inline std::string ConvertXmlToText(
+template<class Filter>
+inline std::string ConvertXmlToText__(
     const std::shared_ptr<NodeImpl>& root,
     const bool indent,
-    const ValueFilter& valueFilter,
-    const bool )
+    const Filter& filter)
 {
     using namespace rapidxml;
 
+    static_assert(IsInPlaceFilter<Filter>::value, "the filter must change a std::string in place");
+
     try {
 
-        xml_document<> doc;
+        RapidXmlDocument document;
+        auto& doc = document.get();
 
         xml_node<>* const decl_node = doc.allocate_node(node_declaration);
         decl_node->append_attribute(doc.allocate_attribute("version", "1.0"));
@@ -170,26 +596,19 @@ inline std::string ConvertXmlToText(
         doc.append_node(decl_node);
 
         std::string name = root->name();
-        const std::string& value = root->text();
 
         xml_node<>* const root_node =
             doc.allocate_node(node_element, doc.allocate_string(name.c_str()));
 
-        if (not value.empty()) {
-            root_node->append_node(
-                doc.allocate_node(
-                    node_data,
-                    nullptr,
-                    doc.allocate_string(valueFilter
-                                        ? GenerateString(value, valueFilter).c_str()
-                                        : value.c_str())));
+        if (not root->text().empty()) {
+            AppendText(doc, root_node, root->type(), TextOf(doc, *root, filter));
         }
 
         doc.append_node(root_node);
-        ConvertXmlToText_(doc, root_node, valueFilter, root);
+        ConvertXmlToText_(doc, root_node, filter, root);
 
         std::string xml_as_string;
-        rapidxml::print(std::back_inserter(xml_as_string), doc, !indent ? print_no_indenting : 0);
+        rapidxml::print(StringOutput {xml_as_string}, doc, !indent ? print_no_indenting : 0);
         return xml_as_string;
 
     } catch (const std::exception& e) {
@@ -199,4 +618,121 @@ inline std::string ConvertXmlToText(
     return "";
 }
 
+} /* anonymous namespace */
+
+template<class Filter>
+inline std::shared_ptr<NodeImpl> ParseXmlFromText(
+    const std::string& text,
+    const Filter& filter,
+    const bool )
+{
+    return ObserveParse(Backend::RAPIDXML, text, [&] {
+        return ParseXmlFromText__(text, filter);
+    });
+}
+
+inline std::shared_ptr<NodeImpl> ParseXmlFromText(
+    const std::string& text,
+    const ValueFilter& valueFilter,
+    const bool useCaching)
+{
+    return WithFilter(valueFilter, [&](const auto& filter) {
+        return ParseXmlFromText(text, filter, useCaching);
+    });
+}
+
+inline std::shared_ptr<NodeImpl> ParseXmlFromTextInParallel(
+    const std::string& text,
+    const ValueFilter& valueFilter,
+    const size_t threads)
+{
+    return ObserveParse(Backend::RAPIDXML, text, [&] {
+        return ParseInParallel(text, threads, [&valueFilter](const std::string& part) {
+            return WithFilter(valueFilter, [&](const auto& filter) {
+                return ParseXmlFromText__(part, filter);
+            });
+        });
+    });
+}
+
+inline std::shared_ptr<NodeImpl> ParseXmlFromTextLazily(const std::string& text)
+{
+    return ObserveParse(Backend::RAPIDXML, text, [&] {
+        return ParseXmlLazily(text);
+    });
+}
+
+// A part of a lazily parsed document, not reported as a parse of its own.
+inline std::shared_ptr<NodeImpl> ParseXmlPart(const std::string& text)
+{
+    return ParseXmlFromText__(text, NoFilter {});
+}
+
+template<class Filter>
+inline std::string ConvertXmlToText(
+    const std::shared_ptr<NodeImpl>& root,
+    const bool indent,
+    const Filter& filter,
+    const bool )
+{
+    return ObserveSerialize(Backend::RAPIDXML, root, [&] {
+        return ConvertXmlToText__(root, indent, filter);
+    });
+}
+
+inline std::string ConvertXmlToText(
+    const std::shared_ptr<NodeImpl>& root,
+    const bool indent,
+    const ValueFilter& valueFilter,
+    const bool useCaching)
+{
+    return WithFilter(valueFilter, [&](const auto& filter) {
+        return ConvertXmlToText(root, indent, filter, useCaching);
+    });
+}
+
+inline std::string ConvertXmlToTextInParallel(
+    const std::shared_ptr<NodeImpl>& root,
+    const bool indent,
+    const ValueFilter& valueFilter,
+    const size_t threads)
+{
+    return ObserveSerialize(Backend::RAPIDXML, root, [&] {
+        return SerializeInParallel(root, threads, [indent, &valueFilter](const std::shared_ptr<NodeImpl>& part) {
+            return WithFilter(valueFilter, [&](const auto& filter) {
+                return ConvertXmlToText__(part, indent, filter);
+            });
+        });
+    });
+}
+
+inline std::vector<std::shared_ptr<NodeImpl>> ParseXmlFromTextBatch(
+    const std::vector<std::string>& texts,
+    const ValueFilter& valueFilter,
+    const size_t threads)
+{
+    return RunBatch<std::shared_ptr<NodeImpl>, std::nullptr_t>(texts, threads, [&valueFilter](std::nullptr_t, const std::string& text) {
+        return ObserveParse(Backend::RAPIDXML, text, [&] {
+            return WithFilter(valueFilter, [&](const auto& filter) {
+                return ParseXmlFromText__(text, filter);
+            });
+        });
+    });
+}
+
+inline std::vector<std::string> ConvertXmlToTextBatch(
+    const std::vector<std::shared_ptr<NodeImpl>>& roots,
+    const bool indent,
+    const ValueFilter& valueFilter,
+    const size_t threads)
+{
+    return RunBatch<std::string, std::nullptr_t>(roots, threads, [indent, &valueFilter](std::nullptr_t, const std::shared_ptr<NodeImpl>& root) {
+        return ObserveSerialize(Backend::RAPIDXML, root, [&] {
+            return WithFilter(valueFilter, [&](const auto& filter) {
+                return ConvertXmlToText__(root, indent, filter);
+            });
+        });
+    });
+}
+
 } /* namespace xml11 */
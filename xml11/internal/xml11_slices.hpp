@@ -0,0 +1,258 @@
+#pragma once
+
+#include "xml11_nodeimpl.hpp"
+#include "xml11_utils.hpp"
+#include "xml11_escape.hpp"
+#include "xml11_filters.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace xml11 {
+
+/********************************************************************************
+ * Scatter-gather serialization.
+ *
+ * Instead of one contiguous string the document is described by a list of
+ * slices in output order, ready to be copied into an iovec array for writev.
+ * Markup and indentation point to static strings, names and texts point to
+ * the nodes' own storage, and only the pieces that have to be generated
+ * (escaped attribute values, filtered values) are owned by the result. Large
+ * text payloads are therefore never copied.
+ *
+ * The layout is the one the libxml2 backend produces: the same declaration,
+ * indentation and escaping, with element text written as is. The result
+ * holds a reference to the root, but the tree must not be changed while
+ * its slices are in use.
+ ********************************************************************************/
+
+struct Slice final {
+    const char* data {nullptr};
+    size_t size {0};
+};
+
+class TextSlices final {
+public:
+    TextSlices(const TextSlices&) = delete;
+    TextSlices& operator = (const TextSlices&) = delete;
+    TextSlices(TextSlices&&) noexcept = default;
+    TextSlices& operator = (TextSlices&&) noexcept = default;
+
+    inline explicit TextSlices(std::shared_ptr<NodeImpl> root) noexcept
+        : m_root {std::move(root)}
+    {
+    }
+
+    inline const std::vector<Slice>& slices() const noexcept
+    {
+        return m_slices;
+    }
+
+    inline size_t size() const noexcept
+    {
+        return m_size;
+    }
+
+    inline std::string str() const
+    {
+        std::string result;
+        result.reserve(m_size);
+        for (const auto& slice : m_slices) {
+            result.append(slice.data, slice.size);
+        }
+        return result;
+    }
+
+    inline void append(const std::string_view text)
+    {
+        if (not text.empty()) {
+            m_slices.push_back(Slice {text.data(), text.size()});
+            m_size += text.size();
+        }
+    }
+
+    // std::deque never moves its elements, so the slice stays valid.
+    inline void appendOwned(std::string text)
+    {
+        append(m_storage.emplace_back(std::move(text)));
+    }
+
+private:
+    std::shared_ptr<NodeImpl> m_root {nullptr};
+    std::vector<Slice> m_slices {};
+    std::deque<std::string> m_storage {};
+    size_t m_size {0};
+};
+
+namespace {
+
+static constexpr std::string_view SPACES =
+    "                                                                ";
+
+static inline std::string EscapeAttribute(const std::string_view value)
+{
+    std::string result;
+    result.reserve(value.size() + 16);
+    AppendEscaped(result, value, ATTRIBUTE_SPECIALS, AttributeEntity);
+    return result;
+}
+
+static inline void AppendIndent(TextSlices& slices, size_t depth)
+{
+    for (depth *= 2; depth; ) {
+        const auto count = std::min(depth, SPACES.size());
+        slices.append(SPACES.substr(0, count));
+        depth -= count;
+    }
+}
+
+template<class Filter>
+static inline void AppendAttribute(
+    TextSlices& slices,
+    const NodeImpl& attribute,
+    const Filter& filter)
+{
+    slices.append(" ");
+    slices.append(attribute.name());
+    slices.append("=\"");
+    if constexpr (not IS_NO_FILTER<Filter>) {
+        auto value = FilteredCopy(attribute.text(), filter);
+        slices.appendOwned(NeedsEscaping(value, ATTRIBUTE_SPECIALS) ? EscapeAttribute(value) : std::move(value));
+    }
+    else if (NeedsEscaping(attribute.text(), ATTRIBUTE_SPECIALS)) {
+        slices.appendOwned(EscapeAttribute(attribute.text()));
+    }
+    else {
+        slices.append(attribute.text());
+    }
+    slices.append("\"");
+}
+
+static inline void AppendText(TextSlices& slices, const NodeType type, const std::string_view text)
+{
+    if (type != NodeType::CDATA) {
+        slices.append(text);
+        return;
+    }
+
+    ForEachCDataSection(text, [&slices](const std::string_view section) {
+        slices.append("<![CDATA[");
+        slices.append(section);
+        slices.append("]]>");
+    });
+}
+
+// Filtered text is owned by the slices before it is split.
+static inline void AppendText(TextSlices& slices, const NodeType type, std::string&& text)
+{
+    if (type != NodeType::CDATA) {
+        slices.appendOwned(std::move(text));
+        return;
+    }
+
+    std::string sections;
+    ForEachCDataSection(text, [&sections](const std::string_view section) {
+        sections.append("<![CDATA[").append(section).append("]]>");
+    });
+    slices.appendOwned(std::move(sections));
+}
+
+// Follows xmlTextWriter: a start tag is closed by a newline only when an
+// element comes next, and text keeps the end tag on its own line.
+template<class Filter>
+static inline void AppendElement(
+    TextSlices& slices,
+    const NodeImpl& node,
+    const bool indent,
+    const Filter& filter,
+    const size_t depth)
+{
+    if (indent) {
+        AppendIndent(slices, depth);
+    }
+
+    slices.append("<");
+    slices.append(node.name());
+    for (const auto& attribute : node.attributes()) {
+        if (attribute) {
+            AppendAttribute(slices, *attribute, filter);
+        }
+    }
+
+    bool isOpen = true;
+    bool isAfterText = false;
+
+    for (const auto& child : node.nodes()) {
+        if (not child) {
+            continue;
+        }
+        if (isOpen) {
+            slices.append(indent ? ">\n" : ">");
+            isOpen = false;
+        }
+        AppendElement(slices, *child, indent, filter, depth + 1);
+    }
+
+    if (not node.text().empty()) {
+        if (isOpen) {
+            slices.append(">");
+            isOpen = false;
+        }
+        if constexpr (not IS_NO_FILTER<Filter>) {
+            AppendText(slices, node.type(), FilteredCopy(node.text(), filter));
+        }
+        else {
+            AppendText(slices, node.type(), node.text());
+        }
+        isAfterText = true;
+    }
+
+    if (isOpen) {
+        slices.append(indent ? "/>\n" : "/>");
+        return;
+    }
+
+    if (indent and not isAfterText) {
+        AppendIndent(slices, depth);
+    }
+    slices.append("</");
+    slices.append(node.name());
+    slices.append(indent ? ">\n" : ">");
+}
+
+} // anonymous namespace
+
+template<class Filter>
+inline TextSlices ConvertXmlToSlices(
+    const std::shared_ptr<NodeImpl>& root,
+    const bool indent,
+    const Filter& filter)
+{
+    static_assert(IsInPlaceFilter<Filter>::value, "the filter must change a std::string in place");
+
+    TextSlices result {root};
+
+    result.append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    AppendElement(result, *root, indent, filter, 0);
+    if (not indent) {
+        result.append("\n");
+    }
+
+    return result;
+}
+
+inline TextSlices ConvertXmlToSlices(
+    const std::shared_ptr<NodeImpl>& root,
+    const bool indent,
+    const ValueFilter& valueFilter)
+{
+    return WithFilter(valueFilter, [&](const auto& filter) {
+        return ConvertXmlToSlices(root, indent, filter);
+    });
+}
+
+} // namespace xml11
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace xml11 {
+
+/********************************************************************************
+ * Opt-in instrumentation.
+ *
+ * Built with USE_XML11_STATS, the library counts what each public operation
+ * costs: allocations and their bytes, nodes created and Node handles that
+ * share a node (each one is an atomic reference count increment). Without
+ * the flag the counting functions are empty and stats() stays zero.
+ *
+ * Allocations are only seen through a replaced global operator new, which a
+ * header-only library cannot provide by itself. Put
+ * XML11_DEFINE_ALLOCATION_HOOK() in exactly one translation unit of the
+ * program to install it.
+ *
+ * Counters are kept per thread, and only the outermost operation is charged:
+ * a findNode made inside toString counts as serialization.
+ ********************************************************************************/
+
+enum class Operation : unsigned char {
+    NONE,
+    PARSE,
+    FIND,
+    BUILD,
+    SERIALIZE,
+};
+
+struct OperationStats final {
+    size_t calls {0};
+    size_t allocations {0};
+    size_t bytes {0};
+    size_t nodes {0};
+    size_t refcounts {0};
+};
+
+struct Stats final {
+    OperationStats parse {};
+    OperationStats find {};
+    OperationStats build {};
+    OperationStats serialize {};
+    OperationStats other {};
+
+    inline OperationStats& operator [] (const Operation operation) noexcept
+    {
+        switch (operation) {
+        case Operation::PARSE: return parse;
+        case Operation::FIND: return find;
+        case Operation::BUILD: return build;
+        case Operation::SERIALIZE: return serialize;
+        default: return other;
+        }
+    }
+
+    inline void reset() noexcept
+    {
+        *this = Stats {};
+    }
+};
+
+inline Stats& stats() noexcept
+{
+    thread_local Stats result;
+    return result;
+}
+
+inline Operation& CurrentOperation() noexcept
+{
+    thread_local Operation operation {Operation::NONE};
+    return operation;
+}
+
+class StatsScope final {
+public:
+    StatsScope(const StatsScope&) = delete;
+    StatsScope& operator = (const StatsScope&) = delete;
+
+    inline explicit StatsScope(const Operation operation) noexcept
+    {
+#ifdef USE_XML11_STATS
+        if (CurrentOperation() == Operation::NONE) {
+            CurrentOperation() = operation;
+            ++stats()[operation].calls;
+            m_isOutermost = true;
+        }
+#else
+        (void)operation;
+#endif
+    }
+
+    inline ~StatsScope() noexcept
+    {
+#ifdef USE_XML11_STATS
+        if (m_isOutermost) {
+            CurrentOperation() = Operation::NONE;
+        }
+#endif
+    }
+
+private:
+#ifdef USE_XML11_STATS
+    bool m_isOutermost {false};
+#endif
+};
+
+inline void CountAllocation(const size_t bytes) noexcept
+{
+#ifdef USE_XML11_STATS
+    auto& current = stats()[CurrentOperation()];
+    ++current.allocations;
+    current.bytes += bytes;
+#else
+    (void)bytes;
+#endif
+}
+
+inline void CountNode() noexcept
+{
+#ifdef USE_XML11_STATS
+    ++stats()[CurrentOperation()].nodes;
+#endif
+}
+
+inline void CountRefcount() noexcept
+{
+#ifdef USE_XML11_STATS
+    ++stats()[CurrentOperation()].refcounts;
+#endif
+}
+
+} // namespace xml11
+
+#ifdef USE_XML11_STATS
+
+namespace xml11 {
+
+// The hook replaces every allocating form of operator new, so memory from
+// any of them is freed by the matching delete below and never by the
+// default one.
+inline void* AllocateCounted(const std::size_t size, const std::size_t alignment = 0) noexcept
+{
+    CountAllocation(size);
+    if (alignment <= alignof(std::max_align_t)) {
+        return std::malloc(size ? size : 1);
+    }
+    const auto rounded = (size + alignment - 1) / alignment * alignment;
+    return std::aligned_alloc(alignment, rounded ? rounded : alignment);
+}
+
+// Every delete frees through this function. Were free called in the body
+// of operator delete, GCC would see it inlined next to a call of operator
+// new and report -Wmismatched-new-delete in any source file that holds the
+// hook and also allocates.
+#if defined(__GNUC__)
+__attribute__((noinline))
+#elif defined(_MSC_VER)
+__declspec(noinline)
+#endif
+inline void FreeCounted(void* const pointer) noexcept
+{
+    std::free(pointer);
+}
+
+} // namespace xml11
+
+#define XML11_DEFINE_ALLOCATION_HOOK()                                                  \
+    void* operator new(std::size_t size)                                                \
+    {                                                                                   \
+        if (void* result = xml11::AllocateCounted(size)) {                              \
+            return result;                                                              \
+        }                                                                               \
+        throw std::bad_alloc {};                                                        \
+    }                                                                                   \
+                                                                                        \
+    void* operator new[](std::size_t size)                                              \
+    {                                                                                   \
+        return operator new(size);                                                      \
+    }                                                                                   \
+                                                                                        \
+    void* operator new(std::size_t size, const std::nothrow_t&) noexcept                \
+    {                                                                                   \
+        return xml11::AllocateCounted(size);                                            \
+    }                                                                                   \
+                                                                                        \
+    void* operator new[](std::size_t size, const std::nothrow_t&) noexcept              \
+    {                                                                                   \
+        return xml11::AllocateCounted(size);                                            \
+    }                                                                                   \
+                                                                                        \
+    void* operator new(std::size_t size, std::align_val_t alignment)                    \
+    {                                                                                   \
+        if (void* result = xml11::AllocateCounted(size, static_cast<std::size_t>(alignment))) { \
+            return result;                                                              \
+        }                                                                               \
+        throw std::bad_alloc {};                                                        \
+    }                                                                                   \
+                                                                                        \
+    void* operator new[](std::size_t size, std::align_val_t alignment)                  \
+    {                                                                                   \
+        return operator new(size, alignment);                                           \
+    }                                                                                   \
+                                                                                        \
+    void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept \
+    {                                                                                   \
+        return xml11::AllocateCounted(size, static_cast<std::size_t>(alignment));       \
+    }                                                                                   \
+                                                                                        \
+    void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept \
+    {                                                                                   \
+        return xml11::AllocateCounted(size, static_cast<std::size_t>(alignment));       \
+    }                                                                                   \
+                                                                                        \
+    void operator delete(void* pointer) noexcept { xml11::FreeCounted(pointer); }       \
+    void operator delete[](void* pointer) noexcept { xml11::FreeCounted(pointer); }     \
+    void operator delete(void* pointer, std::size_t) noexcept { xml11::FreeCounted(pointer); } \
+    void operator delete[](void* pointer, std::size_t) noexcept { xml11::FreeCounted(pointer); } \
+    void operator delete(void* pointer, const std::nothrow_t&) noexcept { xml11::FreeCounted(pointer); } \
+    void operator delete[](void* pointer, const std::nothrow_t&) noexcept { xml11::FreeCounted(pointer); } \
+    void operator delete(void* pointer, std::align_val_t) noexcept { xml11::FreeCounted(pointer); } \
+    void operator delete[](void* pointer, std::align_val_t) noexcept { xml11::FreeCounted(pointer); } \
+    void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { xml11::FreeCounted(pointer); } \
+    void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { xml11::FreeCounted(pointer); } \
+    void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { xml11::FreeCounted(pointer); } \
+    void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { xml11::FreeCounted(pointer); }
+
+#else
+
+#define XML11_DEFINE_ALLOCATION_HOOK()
+
+#endif
@@ -0,0 +1,693 @@
+#pragma once
+
+#include "xml11_nodetype.hpp"
+#include "xml11_exceptions.hpp"
+#include "xml11_escape.hpp"
+#include "xml11_filters.hpp"
+#include "xml11_parallel.hpp"
+#include "xml11_stats.hpp"
+#include "xml11_values.hpp"
+
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace xml11 {
+
+/********************************************************************************
+ * Read-only tape documents.
+ *
+ * A document that is only queried does not need a NodeImpl per node, with
+ * its reference counts, containers and strings of its own. A TapeDocument
+ * keeps the text in one buffer and the nodes in one array of fixed-size
+ * entries in document order: an element is followed by its attributes and
+ * then by its children, and every entry knows where its subtree ends, which
+ * is where its next sibling begins. Walking the children of an element is
+ * index arithmetic over that array.
+ *
+ * The parser makes one pass over the text and writes nothing but entries.
+ * Names point into the buffer; references in texts and attribute values are
+ * decoded in place, since the result is never longer than the reference.
+ * Only an element whose text is split by its children gets the parts joined
+ * at the end of the buffer.
+ *
+ * Lookups follow Node: attributes come before child elements, names are
+ * matched without case unless asked otherwise, and the text of an element
+ * includes the content of its CDATA sections. An element holding only CDATA
+ * sections is of type CDATA, as in Node; where text and sections are mixed,
+ * the tape joins their content to the text while Node keeps their markers.
+ * Comments and processing instructions are skipped; a DTD internal subset
+ * is not supported.
+ *
+ * The parser checks what a reader of the tape could otherwise get wrong:
+ * tags match, names are valid, an element has no two attributes of the same
+ * name, and every reference is a predefined entity or a character XML
+ * allows. It does not check the rest of well-formedness that libxml2 does,
+ * such as the characters of texts, '>' in "]]>" outside of CDATA, the
+ * contents of comments and processing instructions, or the XML declaration.
+ ********************************************************************************/
+
+// One element or attribute of a TapeDocument. Offsets and sizes are in
+// bytes of the buffer, next is the index after the subtree of the entry,
+// and the attributes of an element are the entries right after it.
+struct TapeEntry final {
+    uint32_t name {0};
+    uint32_t nameSize {0};
+    uint32_t text {0};
+    uint32_t textSize {0};
+    uint32_t next {0};
+    uint32_t attributes {0};
+    NodeType type {NodeType::ELEMENT};
+};
+
+namespace {
+
+static inline TapeEntry MakeTapeEntry(
+    const NodeType type,
+    const size_t name,
+    const size_t nameSize,
+    const size_t text,
+    const size_t textSize,
+    const size_t next) noexcept
+{
+    TapeEntry entry;
+    entry.name = static_cast<uint32_t>(name);
+    entry.nameSize = static_cast<uint32_t>(nameSize);
+    entry.text = static_cast<uint32_t>(text);
+    entry.textSize = static_cast<uint32_t>(textSize);
+    entry.next = static_cast<uint32_t>(next);
+    entry.type = type;
+    return entry;
+}
+
+[[noreturn]] static inline void ThrowTapeError(const std::string_view what, const size_t pos)
+{
+    throw Xml11Exception(
+        "Error! " + std::string {what} + " at " + std::to_string(pos) + "! [TapeDocument]");
+}
+
+static inline bool IsTapeNameEnd(const char c) noexcept
+{
+    return IsWhitespace(c) or c == '/' or c == '>' or c == '=';
+}
+
+// A name starts with a letter, '_' or ':' and goes on with letters, digits,
+// '.', '-', '_' and ':'. The bytes of other characters are taken as they are.
+static inline bool IsTapeName(const std::string_view name) noexcept
+{
+    if (name.empty() or std::isdigit(static_cast<unsigned char>(name[0])) or name[0] == '.' or name[0] == '-') {
+        return false;
+    }
+    for (const auto c : name) {
+        const auto u = static_cast<unsigned char>(c);
+        if (not std::isalnum(u) and u < 0x80 and c != '.' and c != '-' and c != '_' and c != ':') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Decodes the references of a text or attribute value where it is and
+// returns its new size. Line breaks become '\n', and in attribute values
+// every whitespace character becomes a space, as XML requires. Anything
+// after an '&' but a predefined entity or a character reference to a
+// character XML allows is an error; offset is where the text is in the
+// document.
+static inline size_t UnescapeInPlace(char* const data, const size_t size, const bool isAttribute, const size_t offset)
+{
+    constexpr auto npos = std::string_view::npos;
+
+    const std::string_view text {data, size};
+    const auto first = FindSpecial(text, isAttribute ? "&\t\n\r" : "&\r", 0);
+
+    size_t out = first;
+    for (auto pos = first; pos < size; ) {
+        auto c = data[pos++];
+
+        if (c == '&') {
+            const auto end = text.find(';', pos);
+            const auto entity = end == npos ? std::string_view {} : text.substr(pos, end - pos);
+
+            char replacement = 0;
+            if (entity == "lt") {
+                replacement = '<';
+            }
+            else if (entity == "gt") {
+                replacement = '>';
+            }
+            else if (entity == "amp") {
+                replacement = '&';
+            }
+            else if (entity == "quot") {
+                replacement = '"';
+            }
+            else if (entity == "apos") {
+                replacement = '\'';
+            }
+
+            if (replacement) {
+                data[out++] = replacement;
+                pos = end + 1;
+                continue;
+            }
+
+            // At most four bytes, so the string does not allocate.
+            std::string code;
+            if (not entity.empty() and entity[0] == '#' and AppendCharacterReference(code, entity.substr(1))) {
+                std::memcpy(data + out, code.data(), code.size());
+                out += code.size();
+                pos = end + 1;
+                continue;
+            }
+
+            ThrowTapeError("Undefined entity", offset + pos - 1);
+        }
+        else if (c == '\r') {
+            c = '\n';
+            if (pos < size and data[pos] == '\n') {
+                ++pos;
+            }
+        }
+
+        data[out++] = isAttribute and IsWhitespace(c) ? ' ' : c;
+    }
+
+    return out;
+}
+
+struct OpenTapeElement final {
+    size_t index {0};
+    bool isJoined {false};
+};
+
+// Parses the buffer into entries, changing only the texts and attribute
+// values in it and appending the joined texts at its end.
+static inline void ParseTape(std::string& buffer, std::vector<TapeEntry>& entries)
+{
+    constexpr auto npos = std::string_view::npos;
+
+    if (buffer.size() >= std::numeric_limits<uint32_t>::max()) {
+        ThrowTapeError("The document is too large", buffer.size());
+    }
+
+    char* const data = buffer.data();
+    const std::string_view text {buffer};
+
+    // Deep enough for most documents, so the stack rarely grows.
+    std::vector<OpenTapeElement> open;
+    open.reserve(32);
+
+    std::vector<size_t> joinedEntries;
+    std::string joined;
+    bool isRootClosed = false;
+
+    // An element holding nothing but CDATA sections is of type CDATA, as in
+    // Node. Mixed content stays ELEMENT, with the text decoded and joined.
+    const auto addText = [&](const size_t begin, size_t size, const bool isCData) {
+        auto& element = open.back();
+        auto& entry = entries[element.index];
+
+        if (isCData) {
+            if (entry.type == NodeType::ELEMENT and entry.textSize == 0) {
+                entry.type = NodeType::CDATA;
+            }
+        }
+        else {
+            size = UnescapeInPlace(data + begin, size, false, begin);
+            entry.type = NodeType::ELEMENT;
+        }
+
+        if (not element.isJoined and entry.textSize == 0) {
+            entry.text = static_cast<uint32_t>(begin);
+            entry.textSize = static_cast<uint32_t>(size);
+            return;
+        }
+
+        // The text so far goes to the end of the joined texts, unless it
+        // already is there.
+        if (not element.isJoined or entry.text + entry.textSize != joined.size()) {
+            const auto start = joined.size();
+            if (element.isJoined) {
+                joined.append(joined, entry.text, entry.textSize);
+            }
+            else {
+                joined.append(data + entry.text, entry.textSize);
+                joinedEntries.push_back(element.index);
+                element.isJoined = true;
+            }
+            entry.text = static_cast<uint32_t>(start);
+        }
+
+        joined.append(data + begin, size);
+        entry.textSize += static_cast<uint32_t>(size);
+    };
+
+    for (size_t pos = 0;;) {
+        const auto tag = FindTagStart(text, pos);
+        const auto end = tag == npos ? text.size() : tag;
+
+        if (not IsBlank(text.substr(pos, end - pos))) {
+            if (open.empty()) {
+                ThrowTapeError("Text outside of the root", pos);
+            }
+            addText(pos, end - pos, false);
+        }
+
+        if (tag == npos) {
+            break;
+        }
+
+        if (StartsWith(text, tag, "<!--")) {
+            pos = SkipPast(text, tag, "-->");
+            if (pos == npos) {
+                ThrowTapeError("Unterminated comment", tag);
+            }
+            continue;
+        }
+
+        if (StartsWith(text, tag, "<![CDATA[")) {
+            const auto close = text.find("]]>", tag + 9);
+            if (open.empty() or close == npos) {
+                ThrowTapeError("Invalid CDATA section", tag);
+            }
+            addText(tag + 9, close - tag - 9, true);
+            pos = close + 3;
+            continue;
+        }
+
+        if (StartsWith(text, tag, "<?")) {
+            pos = SkipPast(text, tag, "?>");
+            if (pos == npos) {
+                ThrowTapeError("Unterminated processing instruction", tag);
+            }
+            continue;
+        }
+
+        if (StartsWith(text, tag, "<!")) {
+            pos = SkipTag(text, tag);
+            if (not entries.empty() or pos == npos or text.substr(tag, pos - tag).find('[') != npos) {
+                ThrowTapeError("Unsupported declaration", tag);
+            }
+            continue;
+        }
+
+        if (StartsWith(text, tag, "</")) {
+            const auto close = text.find('>', tag + 2);
+            if (open.empty() or close == npos) {
+                ThrowTapeError("Unexpected end tag", tag);
+            }
+
+            auto name = text.substr(tag + 2, close - tag - 2);
+            while (not name.empty() and IsWhitespace(name.back())) {
+                name.remove_suffix(1);
+            }
+
+            auto& entry = entries[open.back().index];
+            if (name != text.substr(entry.name, entry.nameSize)) {
+                ThrowTapeError("Mismatched end tag", tag);
+            }
+
+            entry.next = static_cast<uint32_t>(entries.size());
+            open.pop_back();
+            isRootClosed = open.empty();
+            pos = close + 1;
+            continue;
+        }
+
+        if (isRootClosed) {
+            ThrowTapeError("Content after the root", tag);
+        }
+
+        auto p = tag + 1;
+        while (p < text.size() and not IsTapeNameEnd(text[p])) {
+            ++p;
+        }
+        if (p == text.size() or not IsTapeName(text.substr(tag + 1, p - tag - 1))) {
+            ThrowTapeError("Invalid start tag", tag);
+        }
+
+        const auto index = entries.size();
+        entries.push_back(MakeTapeEntry(NodeType::ELEMENT, tag + 1, p - tag - 1, 0, 0, 0));
+
+        for (;;) {
+            while (p < text.size() and IsWhitespace(text[p])) {
+                ++p;
+            }
+            if (p == text.size()) {
+                ThrowTapeError("Unterminated start tag", tag);
+            }
+
+            if (text[p] == '>') {
+                open.push_back(OpenTapeElement {index, false});
+                ++p;
+                break;
+            }
+
+            if (text[p] == '/') {
+                if (not StartsWith(text, p, "/>")) {
+                    ThrowTapeError("Invalid start tag", tag);
+                }
+                entries[index].next = static_cast<uint32_t>(entries.size());
+                isRootClosed = open.empty();
+                p += 2;
+                break;
+            }
+
+            const auto nameBegin = p;
+            while (p < text.size() and not IsTapeNameEnd(text[p])) {
+                ++p;
+            }
+            const auto nameEnd = p;
+            while (p < text.size() and IsWhitespace(text[p])) {
+                ++p;
+            }
+            const auto name = text.substr(nameBegin, nameEnd - nameBegin);
+            if (not IsTapeName(name) or p == text.size() or text[p] != '=') {
+                ThrowTapeError("Invalid attribute", nameBegin);
+            }
+            for (auto other = index + 1; other < entries.size(); ++other) {
+                if (text.substr(entries[other].name, entries[other].nameSize) == name) {
+                    ThrowTapeError("Duplicate attribute", nameBegin);
+                }
+            }
+            ++p;
+            while (p < text.size() and IsWhitespace(text[p])) {
+                ++p;
+            }
+            if (p == text.size() or (text[p] != '"' and text[p] != '\'')) {
+                ThrowTapeError("Invalid attribute", nameBegin);
+            }
+
+            const auto valueBegin = p + 1;
+            const auto valueEnd = text.find(text[p], valueBegin);
+            if (valueEnd == npos or text.substr(valueBegin, valueEnd - valueBegin).find('<') != npos) {
+                ThrowTapeError("Invalid attribute value", valueBegin);
+            }
+
+            const auto valueSize = UnescapeInPlace(data + valueBegin, valueEnd - valueBegin, true, valueBegin);
+            entries.push_back(MakeTapeEntry(
+                NodeType::ATTRIBUTE, nameBegin, nameEnd - nameBegin, valueBegin, valueSize, entries.size() + 1));
+            ++entries[index].attributes;
+
+            p = valueEnd + 1;
+        }
+
+        pos = p;
+    }
+
+    if (entries.empty() or not open.empty()) {
+        ThrowTapeError("Unterminated document", text.size());
+    }
+
+    if (not joined.empty()) {
+        const auto offset = buffer.size();
+        if (offset + joined.size() >= std::numeric_limits<uint32_t>::max()) {
+            ThrowTapeError("The document is too large", offset + joined.size());
+        }
+        buffer += joined;
+        for (const auto index : joinedEntries) {
+            entries[index].text += static_cast<uint32_t>(offset);
+        }
+    }
+}
+
+} // anonymous namespace
+
+class TapeNode;
+using TapeNodeList = std::vector<TapeNode>;
+
+/********************************************************************************
+ * The document owns the buffer and the entries, and its nodes point to it,
+ * so it has to outlive them and stay where it is while they are used.
+ ********************************************************************************/
+
+class TapeDocument final {
+public:
+    TapeDocument(const TapeDocument&) = delete;
+    TapeDocument& operator = (const TapeDocument&) = delete;
+    TapeDocument(TapeDocument&&) noexcept = default;
+    TapeDocument& operator = (TapeDocument&&) noexcept = default;
+
+    // Pass the text with std::move to let the document keep it without a
+    // copy.
+    static inline TapeDocument fromString(std::string text, const bool isCaseInsensitive = true)
+    {
+        const StatsScope scope {Operation::PARSE};
+
+        return TapeDocument {std::move(text), isCaseInsensitive};
+    }
+
+    inline TapeNode root() const noexcept;
+
+    inline size_t size() const noexcept
+    {
+        return m_entries.size();
+    }
+
+    inline bool isCaseInsensitive() const noexcept
+    {
+        return m_isCaseInsensitive;
+    }
+
+private:
+    friend class TapeNode;
+
+    inline TapeDocument(std::string text, const bool isCaseInsensitive)
+        : m_buffer {std::move(text)}
+        , m_isCaseInsensitive {isCaseInsensitive}
+    {
+        ParseTape(m_buffer, m_entries);
+    }
+
+    inline const TapeEntry& entry(const size_t index) const noexcept
+    {
+        return m_entries[index];
+    }
+
+    inline std::string_view view(const uint32_t offset, const uint32_t size) const noexcept
+    {
+        return {m_buffer.data() + offset, size};
+    }
+
+private:
+    std::string m_buffer {};
+    std::vector<TapeEntry> m_entries {};
+    bool m_isCaseInsensitive {true};
+};
+
+/********************************************************************************
+ * A node is a document and an index. A node that was not found is empty:
+ * it converts to false, has no name or text, and finds nothing.
+ ********************************************************************************/
+
+class TapeNode final {
+public:
+    TapeNode() noexcept = default;
+
+    inline TapeNode(const TapeDocument& document, const size_t index) noexcept
+        : m_document {&document}
+        , m_index {index}
+    {
+    }
+
+    inline explicit operator bool() const noexcept
+    {
+        return m_document;
+    }
+
+    inline std::string_view name() const noexcept
+    {
+        return m_document ? m_document->view(entry().name, entry().nameSize) : std::string_view {};
+    }
+
+    inline std::string_view text() const noexcept
+    {
+        return m_document ? m_document->view(entry().text, entry().textSize) : std::string_view {};
+    }
+
+    inline NodeType type() const
+    {
+        if (not m_document) {
+            throw Xml11Exception("Error! Node is not valid! [type]");
+        }
+        return entry().type;
+    }
+
+    inline bool isElement() const
+    {
+        return IsElement(type());
+    }
+
+    template<class T, class = std::enable_if_t<IsValueType<T>::value>>
+    inline std::optional<T> tryAs() const noexcept
+    {
+        return m_document ? ParseValue<T>(text()) : std::nullopt;
+    }
+
+    template<class T, class = std::enable_if_t<IsValueType<T>::value>>
+    inline T as() const
+    {
+        if (const auto value = tryAs<T>()) {
+            return *value;
+        }
+        throw Xml11Exception("Error! The text of the node '" + std::string {name()} + "' is not a valid value! [as]");
+    }
+
+    // Attributes first and then child elements, as Node::nodes gives them.
+    inline TapeNodeList nodes() const
+    {
+        return findAll([](const TapeEntry&) { return true; });
+    }
+
+    /********************************************************************************
+     * Lookups.
+     ********************************************************************************/
+
+    inline TapeNode operator () (const std::string_view name) const noexcept
+    {
+        return findNode(name);
+    }
+
+    inline TapeNode operator () (const NodeType& type) const noexcept
+    {
+        return findNode(type);
+    }
+
+    inline TapeNodeList operator [] (const std::string_view name) const
+    {
+        return findNodes(name);
+    }
+
+    inline TapeNodeList operator [] (const NodeType& type) const
+    {
+        return findNodes(type);
+    }
+
+    inline TapeNode findNode(const std::string_view name) const noexcept
+    {
+        const StatsScope scope {Operation::FIND};
+
+        return findFirst([&name, this](const TapeEntry& child) { return isNamed(child, name); });
+    }
+
+    inline TapeNode findNode(const NodeType& type) const noexcept
+    {
+        const StatsScope scope {Operation::FIND};
+
+        return findFirst([&type](const TapeEntry& child) { return IsOfType(child.type, type); });
+    }
+
+    inline TapeNodeList findNodes(const std::string_view name) const
+    {
+        const StatsScope scope {Operation::FIND};
+
+        return findAll([&name, this](const TapeEntry& child) { return isNamed(child, name); });
+    }
+
+    inline TapeNodeList findNodes(const NodeType& type) const
+    {
+        const StatsScope scope {Operation::FIND};
+
+        return findAll([&type](const TapeEntry& child) { return IsOfType(child.type, type); });
+    }
+
+    inline TapeNode findNodeXPath(const std::string_view path) const noexcept
+    {
+        const StatsScope scope {Operation::FIND};
+
+        auto node = *this;
+        for (size_t begin = 0;;) {
+            const auto end = path.find('/', begin);
+            node = node.findNode(path.substr(begin, end - begin));
+            if (not node or end == std::string_view::npos) {
+                return node;
+            }
+            begin = end + 1;
+        }
+    }
+
+    inline TapeNodeList findNodesXPath(const std::string_view path) const
+    {
+        const StatsScope scope {Operation::FIND};
+
+        const auto last = path.rfind('/');
+        if (last == std::string_view::npos) {
+            return findNodes(path);
+        }
+
+        const auto parent = findNodeXPath(path.substr(0, last));
+        return parent ? parent.findNodes(path.substr(last + 1)) : TapeNodeList {};
+    }
+
+private:
+    inline const TapeEntry& entry() const noexcept
+    {
+        return m_document->entry(m_index);
+    }
+
+    inline bool isNamed(const TapeEntry& child, const std::string_view name) const noexcept
+    {
+        const auto childName = m_document->view(child.name, child.nameSize);
+        return m_document->isCaseInsensitive() ? EqualsFolded(childName, name) : childName == name;
+    }
+
+    // Calls the function with the attributes and then the child elements
+    // until it returns false.
+    template<class Function>
+    inline void forEachChild(Function&& function) const
+    {
+        if (not m_document) {
+            return;
+        }
+
+        const auto end = entry().next;
+        for (auto index = m_index + 1; index < end; index = m_document->entry(index).next) {
+            if (not function(index, m_document->entry(index))) {
+                return;
+            }
+        }
+    }
+
+    template<class Predicate>
+    inline TapeNode findFirst(Predicate&& predicate) const noexcept
+    {
+        TapeNode result;
+        forEachChild([&result, &predicate, this](const size_t index, const TapeEntry& child) {
+            if (predicate(child)) {
+                result = TapeNode {*m_document, index};
+                return false;
+            }
+            return true;
+        });
+        return result;
+    }
+
+    template<class Predicate>
+    inline TapeNodeList findAll(Predicate&& predicate) const
+    {
+        TapeNodeList result;
+        forEachChild([&result, &predicate, this](const size_t index, const TapeEntry& child) {
+            if (predicate(child)) {
+                result.emplace_back(*m_document, index);
+            }
+            return true;
+        });
+        return result;
+    }
+
+private:
+    const TapeDocument* m_document {nullptr};
+    size_t m_index {0};
+};
+
+inline TapeNode TapeDocument::root() const noexcept
+{
+    return TapeNode {*this, 0};
+}
+
+} // namespace xml11
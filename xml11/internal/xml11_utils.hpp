@@ -2,6 +2,7 @@
 
 #include <type_traits>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <optional>
 #include <cctype>
@@ -32,7 +33,7 @@ template<class T, class ... Ts> inline static constexpr auto OneOf_ = (... || Is
 template<class ... Ts> using OneOf = std::enable_if_t<OneOf_<Ts...>, std::true_type>;
 template<class ... Ts> inline static constexpr auto AllOf_ = (... && Ts::value);
 template<class ... Ts> using AllOf = std::enable_if_t<AllOf_<Ts...>, std::true_type>;
-template<class T> using IsIntegral = std::enable_if_t<std::is_integral<std::decay_t<T>>::value, std::true_type>;
+template<class T> using IsArithmetic = std::enable_if_t<std::is_arithmetic<std::decay_t<T>>::value, std::true_type>;
 template<class T> using NotPointer = std::enable_if_t<!std::is_pointer_v<T>, std::true_type>;
 template<class T> using NotString = NoneOf<T, std::string, char*, const char*>;
 
@@ -41,11 +42,11 @@ template<class T> using NotAStringButConvertibleToString = AllOf<
     ConvertibleToString<T>>;
 template<class ... Ts> using WithOptions = AllOf<
     NotEmpty<Ts...>>;
-template<class T, class ... Ts> using LikeAIntegralWithoutOptions = AllOf<
-    IsIntegral<T>,
+template<class T, class ... Ts> using LikeANumberWithoutOptions = AllOf<
+    IsArithmetic<T>,
     Empty<Ts...>>;
-template<class T, class ... Ts> using LikeAIntegralWithOptions = AllOf<
-    IsIntegral<T>,
+template<class T, class ... Ts> using LikeANumberWithOptions = AllOf<
+    IsArithmetic<T>,
     NotEmpty<Ts...>>;
 template<class T> using LikeAnOptionalOfString = AllOf<
     NotString<T>,
@@ -71,13 +72,17 @@ static inline void to_lower_inplace(T&& s)
     std::transform(s.begin(), s.end(), s.begin(), ::tolower);
 }
 
-template <class T, class Fn>
-static inline std::string GenerateString(T&& param, Fn fn = nullptr)
+static inline bool EqualsFolded(const std::string_view lhs, const std::string_view rhs) noexcept
 {
-    if (fn) {
-        return fn(std::forward<T>(param));
+    if (lhs.size() != rhs.size()) {
+        return false;
     }
-    return std::forward<T>(param);
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        if (::tolower(static_cast<unsigned char>(lhs[i])) != ::tolower(static_cast<unsigned char>(rhs[i]))) {
+            return false;
+        }
+    }
+    return true;
 }
 
 static inline std::vector<std::string> split(const std::string &text, const char sep) noexcept
@@ -96,14 +101,52 @@ using ValueFilter = std::function<std::string (const std::string& value)>;
 
 std::shared_ptr<class NodeImpl> ParseXmlFromText(
     const std::string& text,
-    const bool isCaseInsensitive,
     const ValueFilter& valueFilter,
     const bool useCaching);
 
+template<class Filter>
+std::shared_ptr<class NodeImpl> ParseXmlFromText(
+    const std::string& text,
+    const Filter& filter,
+    const bool useCaching);
+
+std::shared_ptr<class NodeImpl> ParseXmlFromTextInParallel(
+    const std::string& text,
+    const ValueFilter& valueFilter,
+    const size_t threads);
+
+std::shared_ptr<class NodeImpl> ParseXmlFromTextLazily(const std::string& text);
+
+std::shared_ptr<class NodeImpl> ParseXmlPart(const std::string& text);
+
 std::string ConvertXmlToText(
     const std::shared_ptr<class NodeImpl>& root,
     const bool indent,
     const ValueFilter& valueFilter,
     const bool useCaching);
 
+template<class Filter>
+std::string ConvertXmlToText(
+    const std::shared_ptr<class NodeImpl>& root,
+    const bool indent,
+    const Filter& filter,
+    const bool useCaching);
+
+std::string ConvertXmlToTextInParallel(
+    const std::shared_ptr<class NodeImpl>& root,
+    const bool indent,
+    const ValueFilter& valueFilter,
+    const size_t threads);
+
+std::vector<std::shared_ptr<class NodeImpl>> ParseXmlFromTextBatch(
+    const std::vector<std::string>& texts,
+    const ValueFilter& valueFilter,
+    const size_t threads);
+
+std::vector<std::string> ConvertXmlToTextBatch(
+    const std::vector<std::shared_ptr<class NodeImpl>>& roots,
+    const bool indent,
+    const ValueFilter& valueFilter,
+    const size_t threads);
+
 } // namespace xml11
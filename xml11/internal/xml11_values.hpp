@@ -0,0 +1,95 @@
+#pragma once
+
+#include <charconv>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+namespace xml11 {
+
+/********************************************************************************
+ * Typed values.
+ *
+ * Numbers are read from the text and written to it with std::from_chars and
+ * std::to_chars: no locale, no stream and no temporary string, and a short
+ * number fits into the string's own buffer. Integers are written the way
+ * std::to_string writes them; floating point values get the shortest text
+ * that reads back to the same value. A bool is written as 1 or 0 and reads
+ * the xs:boolean forms true, false, 1 and 0.
+ ********************************************************************************/
+
+template<class T>
+using IsValueType = std::is_arithmetic<std::decay_t<T>>;
+
+namespace {
+
+static inline std::string_view TrimValue(std::string_view text) noexcept
+{
+    const auto isSpace = [](const char c) {
+        return c == ' ' or c == '\t' or c == '\n' or c == '\r';
+    };
+    while (not text.empty() and isSpace(text.front())) {
+        text.remove_prefix(1);
+    }
+    while (not text.empty() and isSpace(text.back())) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+} // anonymous namespace
+
+template<class T, class = std::enable_if_t<IsValueType<T>::value>>
+inline std::optional<T> ParseValue(std::string_view text) noexcept
+{
+    text = TrimValue(text);
+
+    if constexpr (std::is_same<T, bool>::value) {
+        if (text == "true" or text == "1") {
+            return true;
+        }
+        if (text == "false" or text == "0") {
+            return false;
+        }
+        return std::nullopt;
+    }
+    else {
+        T value {};
+        const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (ec != std::errc() or end != text.data() + text.size() or text.empty()) {
+            return std::nullopt;
+        }
+        return value;
+    }
+}
+
+// Replaces the contents of the string, reusing its storage.
+template<class T, class = std::enable_if_t<IsValueType<T>::value>>
+inline void FormatValue(std::string& out, const T value)
+{
+    // Enough for any integer and for the shortest form of any double.
+    char buffer[64];
+
+    const auto number = [value] {
+        if constexpr (std::is_same<T, bool>::value) {
+            return static_cast<int>(value);
+        }
+        else {
+            return value;
+        }
+    }();
+
+    out.assign(buffer, std::to_chars(buffer, buffer + sizeof(buffer), number).ptr);
+}
+
+template<class T, class = std::enable_if_t<IsValueType<T>::value>>
+inline std::string FormatValue(const T value)
+{
+    std::string result;
+    FormatValue(result, value);
+    return result;
+}
+
+} // namespace xml11